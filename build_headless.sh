@@ -0,0 +1,53 @@
+#!/bin/sh
+# Builds the headless simulation runner (see src/headless.cpp) into run_tree/headless.
+# Linux only: it uses the null renderer and the POSIX platform layer instead of D3D11/Win32.
+
+set -e
+cd "$(dirname "$0")"
+
+CONFIGURATION=${1:-Release}
+if [ "$CONFIGURATION" = "Debug" ]; then
+    FLAGS="-g -O0 -D_DEBUG -DDEBUG"
+else
+    FLAGS="-O2 -DNDEBUG -DRELEASE"
+fi
+
+FREETYPE_CFLAGS=$(pkg-config --cflags freetype2 2>/dev/null || echo "-Iexternal/include")
+FREETYPE_LIBS=$(pkg-config --libs freetype2 2>/dev/null || echo "-lfreetype")
+
+# The whole tree passes string literals as char * (which MSVC accepts), so that one warning is off.
+g++ -std=c++17 $FLAGS -DRENDER_NULL -DBUILD_HEADLESS -Wno-write-strings \
+    -Isrc $FREETYPE_CFLAGS -Iexternal/include \
+    src/headless.cpp \
+    src/benchmarks.cpp \
+    src/main.cpp \
+    src/general.cpp \
+    src/jobs.cpp \
+    src/os_linux.cpp \
+    src/render_commands.cpp \
+    src/render_null.cpp \
+    src/bitmap.cpp \
+    src/shader_registry.cpp \
+    src/texture_registry.cpp \
+    src/animation_registry.cpp \
+    src/font.cpp \
+    src/draw.cpp \
+    src/sprite_batch.cpp \
+    src/hud.cpp \
+    src/entity_manager.cpp \
+    src/entities.cpp \
+    src/spatial_grid.cpp \
+    src/tilemap_collision.cpp \
+    src/tilemap_mesh.cpp \
+    src/light_bins.cpp \
+    src/shadow_segments.cpp \
+    src/text_file_handler.cpp \
+    src/animation.cpp \
+    src/main_menu.cpp \
+    src/camera.cpp \
+    src/cursor.cpp \
+    src/keymap.cpp \
+    src/variable_service.cpp \
+    src/editor.cpp \
+    $FREETYPE_LIBS -lpthread \
+    -o run_tree/headless
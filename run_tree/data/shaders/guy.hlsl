@@ -3,7 +3,7 @@ DepthWrite = "Off"
 AlphaBlend = "On"
 CullFace = "Off"
 FrontFaceIsCounterClockwise = "True"
-VertexType = "XCUN"
+VertexType = "Sprite_Instance"
 RenderTopology = "TriangleList"
 
 #include "data/shaders/shader_globals.hlsli"
@@ -14,12 +14,14 @@ struct VSOutput {
     float2 uv : UV;
 };
 
-VSOutput vertex_main(float3 position : POSITION, float4 color : COLOR, float2 uv : TEXCOORD, float3 normal : NORMAL) {
+VSOutput vertex_main(float2 corner : CORNER, float2 position : POSITION, float2 size : SIZE, float4 uv_rect : UV_RECT, float4 color : COLOR) {
     VSOutput output;
 
-    output.position = mul(transform, float4(position, 1.0));
+    float2 p = position + corner * size;
+    
+    output.position = mul(transform, float4(p, 0.0, 1.0));
     output.color = color;
-    output.uv = uv;
+    output.uv = lerp(uv_rect.xy, uv_rect.zw, corner);
 
     return output;
 }
@@ -3,29 +3,35 @@ DepthWrite = "Off"
 AlphaBlend = "On"
 CullFace = "Off"
 FrontFaceIsCounterClockwise = "True"
-VertexType = "XCUN"
+VertexType = "Sprite"
 RenderTopology = "TriangleList"
 SrcBlend = "DestAlpha"
 DestBlend = "One"
-SrcBlendAlpha = "One"
-DestBlendAlpha = "Zero"
+SrcBlendAlpha = "Zero"
+DestBlendAlpha = "One"
     
 #include "data/shaders/shader_globals.hlsli"
 
 struct VSOutput {
     float4 position : SV_POSITION;
     float4 color : COLOR;
+    float2 offset : OFFSET; // From the center of the light, -1 to 1 across the quad.
 };
 
-VSOutput vertex_main(float3 position : POSITION, float4 color : COLOR, float2 uv : TEXCOORD, float3 normal : NORMAL) {
+VSOutput vertex_main(float2 position : POSITION, float2 uv : TEXCOORD, float4 color : COLOR) {
     VSOutput output;
 
-    output.position = mul(transform, float4(position, 1));
+    output.position = mul(transform, float4(position, 0.0, 1.0));
     output.color = color;
+    output.offset = uv * 2.0 - 1.0;
 
     return output;
 }
 
 float4 pixel_main(VSOutput input) : SV_TARGET {
-    return input.color;
+    float d2 = dot(input.offset, input.offset);
+    clip(1.0 - d2); // Leave the corners of the quad alone.
+
+    float falloff = (1.0 - d2) * (1.0 - d2);
+    return float4(input.color.rgb * falloff, input.color.a);
 }
@@ -1,7 +1,7 @@
 DepthTest = "Off"
 DepthWrite = "Off"
 AlphaBlend = "On"
-CullFace = "Front"
+CullFace = "Off"
 FrontFaceIsCounterClockwise = "True"
 VertexType = "XCUN"
 RenderTopology = "TriangleList"
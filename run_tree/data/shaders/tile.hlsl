@@ -4,7 +4,7 @@ DepthWrite = "Off"
 AlphaBlend = "On"
 CullFace = "Off"
 FrontFaceIsCounterClockwise = "True"
-VertexType = "XCUN"
+VertexType = "Sprite"
 RenderTopology = "TriangleList"
 */
 
@@ -18,14 +18,14 @@ struct VSOutput {
     float3 world_position : POSITION;
 };
 
-VSOutput vertex_main(float3 position : POSITION, float4 color : COLOR, float2 uv : TEXCOORD, float3 normal : NORMAL) {
+VSOutput vertex_main(float2 position : POSITION, float2 uv : TEXCOORD, float4 color : COLOR) {
     VSOutput output;
 
-    output.position = mul(transform, float4(position, 1.0));
+    output.position = mul(transform, float4(position, 0.0, 1.0));
     output.color = color;
     output.uv = uv;
 
-    output.world_position = position;
+    output.world_position = float3(position, 0.0);
 
     return output;
 }
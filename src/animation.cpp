@@ -6,36 +6,16 @@
 
 #define ANIMATION_FILE_VERSION 1
 
-void Animation::update(float dt) {
-    accumulated_dt += dt;
-    if (accumulated_dt >= inv_sampler_rate) {
-        frame_index++;
-        if (frame_index >= num_frames) {
-            if (is_looping) {
-                frame_index = 0;
-            } else {
-                frame_index = num_frames-1;
-                is_completed = true;
-            }
-        }
-        accumulated_dt -= inv_sampler_rate;
-    }
-}
+u32 animation_clip_generation = 0;
 
-Texture *Animation::get_current_frame() {
-    if (!frames) return NULL;
+Texture_Region *Animation::get_frame(int frame_index) {
+    if (!frames || num_frames <= 0) return NULL;
 
-    assert(frame_index >= 0);
-    assert(frame_index < num_frames);
+    // Entities only notice a hotloaded clip on their next update, until then the frame may be out of range.
+    frame_index = Clamp(frame_index, 0, num_frames - 1);
     return frames[frame_index];
 }
 
-void Animation::reset() {
-    accumulated_dt = 0.0f;
-    is_completed = false;
-    frame_index = 0;
-}
-
 bool load_animation(Animation *animation, char *filepath) {
     Text_File_Handler handler;
     handler.start_file(filepath, filepath, tprint("load_animation:%s", filepath));
@@ -56,7 +36,6 @@ bool load_animation(Animation *animation, char *filepath) {
 
     int sampler_rate = atoi(line);
     if (sampler_rate < 1) sampler_rate = 1;
-    float inv_sampler_rate = 1.0f / (float)sampler_rate;
 
     line = handler.consume_next_line();    
     if (!starts_with(line, "is_looping")) {
@@ -95,23 +74,26 @@ bool load_animation(Animation *animation, char *filepath) {
 
     if (animation->frames) {
         delete [] animation->frames;
-        animation->frames;
+        animation->frames = NULL;
+        animation->num_frames = 0;
     }
-    animation->frames = new Texture*[num_frames];
+    animation->frames = new Texture_Region*[num_frames];
     for (int i = 0; i < num_frames; i++) {
         char *line = handler.consume_next_line();
         if (!line) {
             handler.report_error("Expected %d frames", num_frames);
-            delete animation->frames;
+            delete [] animation->frames;
+            animation->frames = NULL;
+            animation_clip_generation += 1; // Entities may still be playing the frames we just deleted.
             return false;
         }
-        animation->frames[i] = globals.texture_registry->get(line);
+        animation->frames[i] = globals.texture_registry->get_region(line);
     }
     
     animation->num_frames = num_frames;
-    animation->frame_index = 0;
-    animation->inv_sampler_rate = inv_sampler_rate;
+    animation->frames_per_second = (float)sampler_rate;
     animation->is_looping = is_looping;
+    animation_clip_generation += 1;
     
     return true;
 }
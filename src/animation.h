@@ -1,6 +1,12 @@
 #pragma once
 
-struct Texture;
+struct Texture_Region;
+
+//
+// A clip, owned by the Animation_Registry and shared by every entity that plays it. Nothing in
+// here changes during playback, the playback state lives with each entity (see the animation
+// columns in Entity_Components).
+//
 
 struct Animation {
     char *full_path = NULL;
@@ -8,18 +14,15 @@ struct Animation {
     u64 modtime = 0;
     
     int num_frames = 0;
-    Texture **frames = NULL;
-    int frame_index = 0;
+    Texture_Region **frames = NULL; // Owned by the Texture_Registry.
     
-    float inv_sampler_rate = 0.0f;
+    float frames_per_second = 0.0f;
     bool is_looping = true;
-    bool is_completed = false; // Only valid if is_looping is false
-    
-    float accumulated_dt = 0.0f;
     
-    void update(float dt);
-    Texture *get_current_frame();
-    void reset();
+    Texture_Region *get_frame(int frame_index);
 };
 
+// Bumped every time a clip gets (re)loaded, so that entities know to pick up the new frames.
+extern u32 animation_clip_generation;
+
 bool load_animation(Animation *animation, char *filepath);
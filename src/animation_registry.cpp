@@ -34,17 +34,17 @@ Animation *Animation_Registry::get(char *name) {
     return animation;
 }
 
-void Animation_Registry::do_hotloading() {
-    for (int i = 0; i < loaded_animations.count; i++) {
-        Animation *animation = loaded_animations[i];
+bool Animation_Registry::hotload(char *full_path) {
+    char *name = get_asset_name_from_path(full_path, ANIMATIONS_DIRECTORY);
+    if (!name) return false;
 
-        u64 modtime = animation->modtime;
-        bool success = get_file_last_write_time(animation->full_path, &modtime);
-        if (!success) continue;
+    Animation **_animation = animation_lookup.find(name);
+    if (!_animation) return true;
 
-        if (animation->modtime != modtime) {
-            animation->modtime = modtime;
-            load_animation(animation, animation->full_path);
-        }
-    }
+    Animation *animation = *_animation;
+    if (!strings_match(animation->full_path, full_path)) return true; // Same name, different extension.
+
+    get_file_last_write_time(full_path, &animation->modtime);
+    load_animation(animation, full_path);
+    return true;
 }
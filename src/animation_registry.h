@@ -12,5 +12,5 @@ struct Animation_Registry {
     Array <Animation *> loaded_animations;
     
     Animation *get(char *name);
-    void do_hotloading();
+    bool hotload(char *full_path);
 };
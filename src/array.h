@@ -4,6 +4,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <new>
+#include <type_traits>
 
 template <typename Array>
 struct Array_Iterator {
@@ -74,10 +76,15 @@ struct Array {
 
     void reserve(int size);
     void resize(int size);
+    void clear();
+    void shrink();
     void add(T const &item);
     T *add();
+    void add_range(T const *items, int num_items);
+    void insert_range(int index, T const *items, int num_items);
     int find(T const &item);
     void ordered_remove_by_index(int n);
+    void unordered_remove_by_index(int n);
 
     T const &operator[](int index) const;
     T &operator[](int index);
@@ -86,8 +93,48 @@ struct Array {
     inline Iterator end() { return data + count; }
 };
 
+//
+// Elements are constructed and destroyed in place, and are relocated with
+// memcpy only when T is trivially copyable. Anything else gets moved.
+//
+
+template <typename T>
+inline void array_destroy(T *items, int num_items) {
+    if (std::is_trivially_destructible<T>::value) return;
+    for (int i = 0; i < num_items; i++) items[i].~T();
+}
+
+// dest and source must not overlap.
+template <typename T>
+inline void array_relocate(T *dest, T *source, int num_items) {
+    if (std::is_trivially_copyable<T>::value) {
+        memcpy((void *)dest, (void *)source, (size_t)num_items * sizeof(T));
+        return;
+    }
+
+    for (int i = 0; i < num_items; i++) {
+        new (&dest[i]) T(static_cast <T &&>(source[i]));
+        source[i].~T();
+    }
+}
+
+// Moves num_items elements at source up by distance slots into uninitialized memory.
+template <typename T>
+inline void array_shift_up(T *source, int num_items, int distance) {
+    if (std::is_trivially_copyable<T>::value) {
+        memmove((void *)(source + distance), (void *)source, (size_t)num_items * sizeof(T));
+        return;
+    }
+
+    for (int i = num_items-1; i >= 0; i--) {
+        new (&source[i + distance]) T(static_cast <T &&>(source[i]));
+        source[i].~T();
+    }
+}
+
 template <typename T>
 inline Array <T>::~Array() {
+    array_destroy(data, count);
     if (data && !use_temporary_storage) {
         free(data);
     }
@@ -97,15 +144,15 @@ template <typename T>
 inline void Array <T>::reserve(int size) {
     if (allocated >= size) return;
 
-    int new_allocated = Max(allocated, size);
+    // Grow geometrically so that a run of add()s stays amortized O(1).
+    int new_allocated = Max(size, allocated * 2);
     new_allocated = Max(new_allocated, 32);
 
-    int new_bytes = new_allocated * sizeof(T);
-    int old_bytes = allocated * sizeof(T);
+    s64 new_bytes = (s64)new_allocated * sizeof(T);
 
     void *new_data = use_temporary_storage ? talloc(new_bytes) : malloc(new_bytes);
     if (data) {
-        memcpy(new_data, data, old_bytes);
+        array_relocate((T *)new_data, data, count);
         if (!use_temporary_storage) {
             free(data);
         }
@@ -117,23 +164,86 @@ inline void Array <T>::reserve(int size) {
 
 template <typename T>
 inline void Array <T>::resize(int size) {
-    reserve(size);
+    if (size < count) {
+        array_destroy(data + size, count - size);
+    } else {
+        reserve(size);
+        for (int i = count; i < size; i++) new (&data[i]) T();
+    }
     count = size;
 }
 
+// Keeps the allocation around so the array can be refilled without reallocating.
+template <typename T>
+inline void Array <T>::clear() {
+    array_destroy(data, count);
+    count = 0;
+}
+
+// Gives back the allocation's tail if less than a quarter of it is in use. Leaves room to grow
+// into so that an array that keeps filling and emptying doesn't reallocate every time.
+template <typename T>
+inline void Array <T>::shrink() {
+    if (use_temporary_storage) return;
+    if (allocated <= 32 || count * 4 >= allocated) return;
+
+    int new_allocated = Max(count * 2, 32);
+    T *new_data = (T *)malloc((s64)new_allocated * sizeof(T));
+    array_relocate(new_data, data, count);
+    free(data);
+
+    data = new_data;
+    allocated = new_allocated;
+}
+
 template <typename T>
 inline void Array <T>::add(T const &item) {
-    reserve(count+1);
-    data[count] = item;
+    if (count + 1 > allocated) {
+        // item might live in our own buffer, so copy it before growing.
+        T copy = item;
+        reserve(count+1);
+        new (&data[count]) T(static_cast <T &&>(copy));
+    } else {
+        new (&data[count]) T(item);
+    }
     count++;
 }
 
 template <typename T>
 inline T *Array <T>::add() {
-    add({});
+    reserve(count+1);
+    new (&data[count]) T();
+    count++;
     return &data[count-1];
 }
 
+// items must not point into this array.
+template <typename T>
+inline void Array <T>::add_range(T const *items, int num_items) {
+    insert_range(count, items, num_items);
+}
+
+// items must not point into this array.
+template <typename T>
+inline void Array <T>::insert_range(int index, T const *items, int num_items) {
+    assert(index >= 0);
+    assert(index <= count);
+    assert(num_items >= 0);
+    assert(!data || items + num_items <= data || items >= data + allocated);
+
+    if (!num_items) return;
+
+    reserve(count + num_items);
+    array_shift_up(data + index, count - index, num_items);
+
+    if (std::is_trivially_copyable<T>::value) {
+        memcpy((void *)(data + index), (void *)items, (size_t)num_items * sizeof(T));
+    } else {
+        for (int i = 0; i < num_items; i++) new (&data[index + i]) T(items[i]);
+    }
+    count += num_items;
+}
+
 template <typename T>
 inline int Array <T>::find(T const &item) {
     for (int i = 0; i < count; i++) {
@@ -144,9 +254,26 @@ inline int Array <T>::find(T const &item) {
 
 template <typename T>
 inline void Array <T>::ordered_remove_by_index(int n) {
+    assert(n >= 0);
+    assert(n < count);
+    
     for (int i = n; i < count-1; i++) {
-        data[i] = data[i+1];
+        data[i] = static_cast <T &&>(data[i+1]);
+    }
+    array_destroy(data + count-1, 1);
+    count--;
+}
+
+// O(1), but moves the last element into the removed slot.
+template <typename T>
+inline void Array <T>::unordered_remove_by_index(int n) {
+    assert(n >= 0);
+    assert(n < count);
+
+    if (n != count-1) {
+        data[n] = static_cast <T &&>(data[count-1]);
     }
+    array_destroy(data + count-1, 1);
     count--;
 }
 
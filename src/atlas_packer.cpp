@@ -0,0 +1,349 @@
+//
+// Packs every image under a directory into as few atlas pages as it can, with a skyline packer,
+// and writes the pages next to a text file that says where each image ended up. The game loads
+// that file with Texture_Registry::load_atlas.
+//
+//     atlas_packer <input directory> <output directory> <atlas name> [max page size]
+//
+// For the game that's:
+//
+//     atlas_packer data/textures data/atlases textures
+//
+// run from the run_tree. Images are named like the Texture_Registry names them: the path
+// relative to the input directory, without the extension. Every image is extruded by
+// ATLAS_EXTRUDE pixels so that filtering at the edge of a region doesn't pick up its neighbours.
+// Images that don't get packed are still found by the game, as textures of their own.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#define ATLAS_FILE_VERSION 1
+
+const int ATLAS_EXTRUDE = 2;
+const int ATLAS_MIN_PAGE_SIZE = 128;
+const int ATLAS_MAX_IMAGE_SIZE = 512; // Anything bigger (backgrounds) gets a page to itself anyway, so it stays a texture of its own.
+
+struct Atlas_Image {
+    std::string name;
+    std::string full_path;
+
+    int width = 0;
+    int height = 0;
+    unsigned char *data = NULL;
+
+    int page = -1;
+    int x = 0; // Top left of the image itself, the extrusion is around it.
+    int y = 0;
+};
+
+struct Skyline_Node {
+    int x;
+    int y;
+    int width;
+};
+
+// Bottom-left skyline packer: every image goes where its top ends up lowest, ties go left.
+struct Skyline {
+    int page_size = 0;
+    std::vector <Skyline_Node> nodes;
+
+    void reset(int size) {
+        page_size = size;
+        nodes.clear();
+        nodes.push_back({ 0, 0, size });
+    }
+
+    // The y an image of this width would sit at if its left edge went on node index, or -1.
+    int fit(int index, int width, int height) {
+        int x = nodes[index].x;
+        if (x + width > page_size) return -1;
+
+        int y = 0;
+        int remaining = width;
+        for (int i = index; remaining > 0; i++) {
+            if (i >= (int)nodes.size()) return -1;
+            y = std::max(y, nodes[i].y);
+            if (y + height > page_size) return -1;
+            remaining -= nodes[i].width;
+        }
+
+        return y;
+    }
+
+    bool insert(int width, int height, int *out_x, int *out_y) {
+        int best_index = -1;
+        int best_top = page_size + 1;
+        int best_width = page_size + 1;
+        int best_y = 0;
+
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            int y = fit(i, width, height);
+            if (y < 0) continue;
+
+            int top = y + height;
+            if (top < best_top || (top == best_top && nodes[i].width < best_width)) {
+                best_index = i;
+                best_top = top;
+                best_width = nodes[i].width;
+                best_y = y;
+            }
+        }
+
+        if (best_index < 0) return false;
+
+        Skyline_Node node = { nodes[best_index].x, best_y + height, width };
+        nodes.insert(nodes.begin() + best_index, node);
+
+        // Shrink or drop the nodes the new one now covers.
+        for (int i = best_index + 1; i < (int)nodes.size(); i++) {
+            int covered = (nodes[i-1].x + nodes[i-1].width) - nodes[i].x;
+            if (covered <= 0) break;
+
+            nodes[i].x += covered;
+            nodes[i].width -= covered;
+            if (nodes[i].width > 0) break;
+
+            nodes.erase(nodes.begin() + i);
+            i--;
+        }
+
+        // Merge neighbours at the same height.
+        for (int i = 0; i + 1 < (int)nodes.size(); i++) {
+            if (nodes[i].y == nodes[i+1].y) {
+                nodes[i].width += nodes[i+1].width;
+                nodes.erase(nodes.begin() + i + 1);
+                i--;
+            }
+        }
+
+        *out_x = node.x;
+        *out_y = best_y;
+        return true;
+    }
+};
+
+static bool is_image_extension(std::string extension) {
+    for (char &c : extension) c = (char)tolower(c);
+    return extension == ".png" || extension == ".jpg" || extension == ".bmp";
+}
+
+// Same order the Texture_Registry looks for extensions in, so both pick the same file.
+static int get_extension_priority(std::string extension) {
+    for (char &c : extension) c = (char)tolower(c);
+    if (extension == ".png") return 0;
+    if (extension == ".jpg") return 1;
+    return 2;
+}
+
+static bool compare_images_for_packing(Atlas_Image *a, Atlas_Image *b) {
+    if (a->height != b->height) return a->height > b->height;
+    if (a->width != b->width) return a->width > b->width;
+    return a->name < b->name;
+}
+
+// Packs the images into pages of page_size, returns the number of pages used, or -1 if some
+// image doesn't fit on a page this size at all.
+static int pack_images(std::vector <Atlas_Image *> &images, int page_size) {
+    int num_pages = 0;
+    Skyline skyline;
+
+    std::vector <Atlas_Image *> remaining = images;
+    while (!remaining.empty()) {
+        skyline.reset(page_size);
+
+        std::vector <Atlas_Image *> did_not_fit;
+        for (Atlas_Image *image : remaining) {
+            int x, y;
+            int padded_width = image->width + ATLAS_EXTRUDE * 2;
+            int padded_height = image->height + ATLAS_EXTRUDE * 2;
+            if (!skyline.insert(padded_width, padded_height, &x, &y)) {
+                did_not_fit.push_back(image);
+                continue;
+            }
+
+            image->page = num_pages;
+            image->x = x + ATLAS_EXTRUDE;
+            image->y = y + ATLAS_EXTRUDE;
+        }
+
+        if (did_not_fit.size() == remaining.size()) return -1;
+
+        num_pages++;
+        remaining = did_not_fit;
+    }
+
+    return num_pages;
+}
+
+static void blit_extruded(unsigned char *page, int page_size, Atlas_Image *image) {
+    for (int y = -ATLAS_EXTRUDE; y < image->height + ATLAS_EXTRUDE; y++) {
+        int sy = std::min(std::max(y, 0), image->height - 1);
+        for (int x = -ATLAS_EXTRUDE; x < image->width + ATLAS_EXTRUDE; x++) {
+            int sx = std::min(std::max(x, 0), image->width - 1);
+
+            unsigned char *source = &image->data[(sy * image->width + sx) * 4];
+            unsigned char *dest = &page[((image->y + y) * page_size + (image->x + x)) * 4];
+            memcpy(dest, source, 4);
+        }
+    }
+}
+
+static void print_usage() {
+    fprintf(stderr, "atlas_packer <input directory> <output directory> <atlas name> [max page size]\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+
+    std::filesystem::path input_dir = argv[1];
+    std::filesystem::path output_dir = argv[2];
+    std::string atlas_name = argv[3];
+
+    int max_page_size = 2048;
+    if (argc > 4) max_page_size = atoi(argv[4]);
+    if (max_page_size < ATLAS_MIN_PAGE_SIZE) {
+        fprintf(stderr, "Max page size has to be at least %d.\n", ATLAS_MIN_PAGE_SIZE);
+        return 1;
+    }
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(input_dir, error)) {
+        fprintf(stderr, "'%s' is not a directory.\n", argv[1]);
+        return 1;
+    }
+
+    std::vector <Atlas_Image *> images;
+    for (auto &entry : std::filesystem::recursive_directory_iterator(input_dir)) {
+        if (!entry.is_regular_file()) continue;
+
+        std::filesystem::path path = entry.path();
+        std::string extension = path.extension().string();
+        if (!is_image_extension(extension)) continue;
+
+        std::filesystem::path relative = std::filesystem::relative(path, input_dir);
+        relative.replace_extension();
+        std::string name = relative.generic_string();
+
+        // name.png and name.jpg are the same texture as far as the game is concerned.
+        Atlas_Image *existing = NULL;
+        for (Atlas_Image *image : images) {
+            if (image->name == name) existing = image;
+        }
+
+        if (existing) {
+            std::string existing_extension = std::filesystem::path(existing->full_path).extension().string();
+            if (get_extension_priority(existing_extension) <= get_extension_priority(extension)) continue;
+            existing->full_path = path.string();
+            continue;
+        }
+
+        Atlas_Image *image = new Atlas_Image();
+        image->name = name;
+        image->full_path = path.string();
+        images.push_back(image);
+    }
+
+    std::vector <Atlas_Image *> packable;
+    for (Atlas_Image *image : images) {
+        int channels;
+        image->data = stbi_load(image->full_path.c_str(), &image->width, &image->height, &channels, 4);
+        if (!image->data) {
+            fprintf(stderr, "Failed to load file '%s', skipping it.\n", image->full_path.c_str());
+            continue;
+        }
+
+        int padded_width = image->width + ATLAS_EXTRUDE * 2;
+        int padded_height = image->height + ATLAS_EXTRUDE * 2;
+        int max_size = std::min(ATLAS_MAX_IMAGE_SIZE, max_page_size);
+        if (padded_width > max_size || padded_height > max_size) {
+            printf("'%s' is %dx%d, too big to pack, it stays a texture of its own.\n", image->name.c_str(), image->width, image->height);
+            continue;
+        }
+
+        packable.push_back(image);
+    }
+
+    if (packable.empty()) {
+        fprintf(stderr, "Found no images to pack in '%s'.\n", argv[1]);
+        return 1;
+    }
+
+    std::sort(packable.begin(), packable.end(), compare_images_for_packing);
+
+    // Smallest power of two page that fits everything, or as many max size pages as it takes.
+    int page_size = ATLAS_MIN_PAGE_SIZE;
+    int num_pages = pack_images(packable, page_size);
+    while (num_pages != 1 && page_size < max_page_size) {
+        page_size = std::min(page_size * 2, max_page_size);
+        num_pages = pack_images(packable, page_size);
+    }
+
+    std::filesystem::create_directories(output_dir, error);
+
+    std::vector <std::string> page_filenames;
+    for (int page_index = 0; page_index < num_pages; page_index++) {
+        std::vector <unsigned char> pixels(page_size * page_size * 4, 0);
+        for (Atlas_Image *image : packable) {
+            if (image->page == page_index) blit_extruded(pixels.data(), page_size, image);
+        }
+
+        char filename[256] = {};
+        snprintf(filename, sizeof(filename), "%s_%d.png", atlas_name.c_str(), page_index);
+        page_filenames.push_back(filename);
+
+        std::string page_path = (output_dir / filename).string();
+        if (!stbi_write_png(page_path.c_str(), page_size, page_size, 4, pixels.data(), page_size * 4)) {
+            fprintf(stderr, "Failed to write '%s'.\n", page_path.c_str());
+            return 1;
+        }
+    }
+
+    // Written last, so that the game only hotloads it once the pages are all there.
+    std::string atlas_path = (output_dir / (atlas_name + ".atlas")).string();
+    FILE *file = fopen(atlas_path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", atlas_path.c_str());
+        return 1;
+    }
+
+    std::sort(packable.begin(), packable.end(), [](Atlas_Image *a, Atlas_Image *b) { return a->name < b->name; });
+
+    fprintf(file, "[%d] # Version number\n\n", ATLAS_FILE_VERSION);
+    fprintf(file, "# Generated by atlas_packer from '%s'. Regions are in pixels, from the top left of their page.\n\n", input_dir.generic_string().c_str());
+    fprintf(file, "num_pages %d\n", num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        fprintf(file, "page %d %d %s\n", page_size, page_size, page_filenames[i].c_str());
+    }
+    fprintf(file, "\n");
+
+    fprintf(file, "num_regions %d\n", (int)packable.size());
+    for (Atlas_Image *image : packable) {
+        fprintf(file, "region %d %d %d %d %d %s\n", image->page, image->x, image->y, image->width, image->height, image->name.c_str());
+    }
+
+    fclose(file);
+
+    printf("Packed %d images into %d page(s) of %dx%d.\n", (int)packable.size(), num_pages, page_size, page_size);
+
+    for (Atlas_Image *image : images) {
+        if (image->data) stbi_image_free(image->data);
+        delete image;
+    }
+
+    return 0;
+}
@@ -0,0 +1,782 @@
+#include "pch.h"
+
+#include "benchmarks.h"
+#include "os.h"
+#include "entity_manager.h"
+#include "entities.h"
+#include "animation.h"
+#include "jobs.h"
+#include "render_vertex.h"
+
+#include <thread>
+
+//
+// Every benchmark runs enough rounds at its smaller sizes to do about BENCHMARK_OPS_PER_SIZE
+// operations, so that the small sizes don't just time get_time. The results also get checked
+// (and summed), so that the compiler can't throw the work away.
+//
+
+const s64 BENCHMARK_OPS_PER_SIZE = 10 * 1000 * 1000;
+
+static int get_num_rounds(s64 count) {
+    return (int)Max(BENCHMARK_OPS_PER_SIZE / count, (s64)1);
+}
+
+static double ns_per_op(double seconds, s64 num_ops) {
+    return seconds * 1e9 / (double)num_ops;
+}
+
+//
+// Hash_Table
+//
+
+// The table Hash_Table replaced, as it was: one slot per probe, a separate occupancy mask, no
+// remove, and grow() only once every slot is full.
+inline int old_hash(int x) {
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = (x >> 16) ^ x;
+    return x;
+}
+
+template <typename Key, typename Value>
+struct Old_Hash_Table {
+    struct Bucket {
+        Key key;
+        Value value;
+    };
+
+    Bucket *buckets = nullptr;
+    bool *occupancy_mask = nullptr;
+    int allocated = 0;
+    int count = 0;
+
+    inline void grow() {
+        const int HASH_TABLE_INITIAL_CAPACITY = 256;
+
+        if (!buckets) {
+            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
+            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
+            allocated = HASH_TABLE_INITIAL_CAPACITY;
+            count = 0;
+        } else {
+            Old_Hash_Table <Key, Value> new_hash_table = {
+                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
+                (bool *)calloc(allocated * 2, sizeof(bool)),
+                allocated * 2,
+                0,
+            };
+
+            for (int i = 0; i < count; i++) {
+                if (occupancy_mask[i]) {
+                    new_hash_table.add(buckets[i].key, buckets[i].value);
+                }
+            }
+
+            free(buckets);
+            free(occupancy_mask);
+
+            *this = new_hash_table;
+        }
+    }
+
+    inline void add(Key key, Value value) {
+        if (count >= allocated) {
+            grow();
+        }
+
+        auto hk = old_hash(key) & (allocated - 1);
+        while (occupancy_mask[hk] && buckets[hk].key != key) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        occupancy_mask[hk] = true;
+        buckets[hk].key = key;
+        buckets[hk].value = value;
+        count++;
+    }
+
+    inline Value *find(Key key) {
+        auto hk = old_hash(key) & (allocated - 1);
+        for (int i = 0; i < allocated && occupancy_mask[hk] && buckets[hk].key != key; i++) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        if (buckets && occupancy_mask[hk] && buckets[hk].key == key) {
+            return &buckets[hk].value;
+        } else {
+            return nullptr;
+        }
+    }
+
+    inline void deinit() {
+        free(buckets);
+        free(occupancy_mask);
+        *this = Old_Hash_Table <Key, Value>();
+    }
+};
+
+// Present keys are even before scrambling and missing ones odd. Multiplying by an odd number
+// is a bijection on 32 bits, so no present key equals a missing one.
+static int get_hash_table_key(s64 i, bool present) {
+    u32 x = (u32)(i * 2 + (present ? 0 : 1));
+    return (int)(x * 0x9e3779b1u);
+}
+
+struct Hash_Table_Timings {
+    double insert = 0.0;
+    double find_hit = 0.0;
+    double find_miss = 0.0;
+    double erase = 0.0;
+
+    s64 num_found = 0;   // Of the present keys, over all rounds.
+    s64 num_missed = 0;  // Missing keys that weren't found, over all rounds.
+    s64 num_erased = 0;
+};
+
+template <typename Table>
+static void time_table_lookups(Table *table, int count, Hash_Table_Timings *t) {
+    double start = get_time();
+    for (int i = 0; i < count; i++) {
+        int *value = table->find(get_hash_table_key(i, true));
+        if (value && *value == i) t->num_found += 1;
+    }
+    t->find_hit += get_time() - start;
+
+    start = get_time();
+    for (int i = 0; i < count; i++) {
+        if (!table->find(get_hash_table_key(i, false))) t->num_missed += 1;
+    }
+    t->find_miss += get_time() - start;
+}
+
+template <typename Table>
+static double time_table_inserts(Table *table, int count) {
+    double start = get_time();
+    for (int i = 0; i < count; i++) table->add(get_hash_table_key(i, true), i);
+    return get_time() - start;
+}
+
+static Hash_Table_Timings time_new_table(int count, int num_rounds) {
+    Hash_Table_Timings t;
+    for (int round = 0; round < num_rounds; round++) {
+        Hash_Table <int, int> table;
+        t.insert += time_table_inserts(&table, count);
+        time_table_lookups(&table, count, &t);
+
+        double start = get_time();
+        for (int i = 0; i < count; i++) {
+            if (table.remove(get_hash_table_key(i, true))) t.num_erased += 1;
+        }
+        t.erase += get_time() - start;
+
+        table.deinit();
+    }
+    return t;
+}
+
+static Hash_Table_Timings time_old_table(int count, int num_rounds) {
+    Hash_Table_Timings t;
+    for (int round = 0; round < num_rounds; round++) {
+        Old_Hash_Table <int, int> table;
+        t.insert += time_table_inserts(&table, count);
+        time_table_lookups(&table, count, &t);
+        table.deinit();
+    }
+    return t;
+}
+
+static void print_hash_table_timings(char *name, Hash_Table_Timings *t, s64 num_ops, bool has_erase) {
+    print("    %-4s insert %7.2fns  find-hit %7.2fns  find-miss %7.2fns  erase ", name,
+          ns_per_op(t->insert, num_ops), ns_per_op(t->find_hit, num_ops), ns_per_op(t->find_miss, num_ops));
+    if (has_erase) print("%7.2fns\n", ns_per_op(t->erase, num_ops));
+    else print("    n/a, it has no remove\n");
+}
+
+bool benchmark_hash_table() {
+    s64 sizes[] = { 1000, 100 * 1000, 10 * 1000 * 1000 };
+    bool ok = true;
+
+    print("Hash_Table <int, int>, per operation:\n");
+    for (s64 size : sizes) {
+        int count = (int)size;
+        int num_rounds = get_num_rounds(size);
+        s64 num_ops = size * num_rounds;
+
+        print("  %lld keys, %d rounds:\n", (long long)size, num_rounds);
+
+        Hash_Table_Timings t = time_new_table(count, num_rounds);
+        print_hash_table_timings("new", &t, num_ops, true);
+        if (t.num_found != num_ops || t.num_missed != num_ops || t.num_erased != num_ops) {
+            print("    new table: found %lld, missed %lld and erased %lld of %lld!\n",
+                  (long long)t.num_found, (long long)t.num_missed, (long long)t.num_erased, (long long)num_ops);
+            ok = false;
+        }
+
+        Hash_Table_Timings old = time_old_table(count, num_rounds);
+        print_hash_table_timings("old", &old, num_ops, false);
+        if (old.num_found != num_ops || old.num_missed != num_ops) {
+            print("    old table: found %lld and missed %lld of %lld.\n",
+                  (long long)old.num_found, (long long)old.num_missed, (long long)num_ops);
+        }
+    }
+
+    fflush(stdout);
+    return ok;
+}
+
+//
+// Array
+//
+
+bool benchmark_array() {
+    const int COUNT = 10 * 1000 * 1000;
+    const int RANGE_SIZE = 1000;
+    bool ok = true;
+
+    s64 expected_sum = (s64)COUNT * (COUNT - 1) / 2;
+
+    print("Array <int>, %d elements, per element:\n", COUNT);
+
+    // Growing one add at a time.
+    Array <int> array;
+    int num_reallocations = 0;
+    double start = get_time();
+    for (int i = 0; i < COUNT; i++) {
+        int allocated = array.allocated;
+        array.add(i);
+        if (array.allocated != allocated) num_reallocations += 1;
+    }
+    double add_time = get_time() - start;
+    print("    add                        %6.2fns  (%d reallocations)\n", ns_per_op(add_time, COUNT), num_reallocations);
+
+    // Iterating.
+    start = get_time();
+    s64 sum = 0;
+    for (int value : array) sum += value;
+    double iterate_time = get_time() - start;
+    print("    iterate                    %6.2fns\n", ns_per_op(iterate_time, COUNT));
+    if (sum != expected_sum) {
+        print("    iterating summed to %lld instead of %lld!\n", (long long)sum, (long long)expected_sum);
+        ok = false;
+    }
+
+    // Growing a range at a time, from what is already there.
+    Array <int> ranges;
+    start = get_time();
+    for (int i = 0; i < COUNT; i += RANGE_SIZE) {
+        ranges.add_range(array.data + i, Min(RANGE_SIZE, COUNT - i));
+    }
+    double add_range_time = get_time() - start;
+    print("    add_range                  %6.2fns  (%d at a time)\n", ns_per_op(add_range_time, COUNT), RANGE_SIZE);
+    if (ranges.count != COUNT || memcmp(ranges.data, array.data, COUNT * sizeof(int))) {
+        print("    add_range copied something else!\n");
+        ok = false;
+    }
+
+    // Swap-removing from random places until nothing is left.
+    u32 random_state = 12345;
+    sum = 0;
+    start = get_time();
+    while (array.count) {
+        random_state = random_state * 1664525u + 1013904223u;
+        int index = (int)(((u64)random_state * (u64)array.count) >> 32);
+        sum += array[index];
+        array.unordered_remove_by_index(index);
+    }
+    double remove_time = get_time() - start;
+    print("    unordered_remove_by_index  %6.2fns\n", ns_per_op(remove_time, COUNT));
+    if (sum != expected_sum) {
+        print("    removed elements summed to %lld instead of %lld!\n", (long long)sum, (long long)expected_sum);
+        ok = false;
+    }
+
+    fflush(stdout);
+    return ok;
+}
+
+//
+// Entity_Components
+//
+
+// Entities as they were before Entity_Components: every one its own allocation, with the hot
+// fields in between the cold ones, and playback state in the (shared) clip.
+struct Old_Animation {
+    int num_frames = 4;
+    int frame_index = 0;
+    float inv_sampler_rate = 0.1f;
+    bool is_looping = true;
+    bool is_completed = false;
+    float accumulated_dt = 0.0f;
+
+    void update(float dt) {
+        accumulated_dt += dt;
+        if (accumulated_dt >= inv_sampler_rate) {
+            frame_index++;
+            if (frame_index >= num_frames) {
+                if (is_looping) {
+                    frame_index = 0;
+                } else {
+                    frame_index = num_frames-1;
+                    is_completed = true;
+                }
+            }
+            accumulated_dt -= inv_sampler_rate;
+        }
+    }
+};
+
+struct Old_Entity {
+    Entity_Type type;
+    int id;
+    Entity_Manager *manager;
+
+    Vector2 position;
+    Vector2 size;
+
+    Old_Animation *current_animation;
+};
+
+struct Old_Guy : public Old_Entity {
+    bool is_active = false;
+
+    Vector2 velocity;
+    Vector2 max_velocity;
+
+    Guy_State current_state = GUY_STATE_IDLE;
+    Guy_Orientation orientation = GUY_LOOKING_DOWN;
+
+    Old_Animation *looking_down_idle_animation;
+    Old_Animation *looking_right_idle_animation;
+    Old_Animation *looking_up_idle_animation;
+    Old_Animation *looking_left_idle_animation;
+
+    Old_Animation *looking_down_moving_animation;
+    Old_Animation *looking_right_moving_animation;
+    Old_Animation *looking_up_moving_animation;
+    Old_Animation *looking_left_moving_animation;
+
+    int light_source_id;
+};
+
+// The same movement for both layouts: velocity damped towards zero, then integrated.
+static void move(Vector2 *position, Vector2 *velocity, float dt) {
+    float damping = 1.0f - 2.0f * dt;
+    velocity->x *= damping;
+    velocity->y *= damping;
+    position->x += velocity->x * dt;
+    position->y += velocity->y * dt;
+}
+
+static Vector2 get_mover_velocity(int i) {
+    return Vector2((float)(i % 7) - 3.0f, (float)(i % 5) - 2.0f);
+}
+
+bool benchmark_entity_components() {
+    const int NUM_MOVERS = 100 * 1000;
+    const int NUM_TICKS = 600;
+    const float dt = 1.0f / 60.0f;
+
+    print("%d movers, %d ticks, per tick:\n", NUM_MOVERS, NUM_TICKS);
+
+    // Old layout. Like the old Guys, they share their clips.
+    Old_Animation clips[8];
+    Array <Old_Guy *> old_guys;
+    for (int i = 0; i < NUM_MOVERS; i++) {
+        Old_Guy *guy = new Old_Guy();
+        guy->position = Vector2((float)(i % 400), (float)(i / 400));
+        guy->size = Vector2(1, 1);
+        guy->velocity = get_mover_velocity(i);
+
+        Old_Animation **animations = &guy->looking_down_idle_animation;
+        for (int j = 0; j < 8; j++) animations[j] = &clips[j];
+        guy->current_animation = animations[i % 8];
+
+        old_guys.add(guy);
+    }
+
+    double start = get_time();
+    for (int tick = 0; tick < NUM_TICKS; tick++) {
+        for (Old_Guy *guy : old_guys) {
+            move(&guy->position, &guy->velocity, dt);
+            if (guy->current_animation) guy->current_animation->update(dt);
+        }
+    }
+    double old_time = get_time() - start;
+
+    // Entity_Components, updated the way simulate_game does.
+    Entity_Manager *manager = new Entity_Manager();
+    manager->animation_clip_generation = animation_clip_generation;
+
+    Entity_Components *c = &manager->components;
+    for (int i = 0; i < NUM_MOVERS; i++) {
+        int row = c->add_row(NULL);
+        c->position[row] = Vector2((float)(i % 400), (float)(i / 400));
+        c->size[row] = Vector2(1, 1);
+        c->velocity[row] = get_mover_velocity(i);
+        c->animation_rate[row] = 10.0f;
+        c->animation_num_frames[row] = 4;
+        c->animation_is_looping[row] = 1.0f;
+    }
+
+    start = get_time();
+    for (int tick = 0; tick < NUM_TICKS; tick++) {
+        Vector2 *positions = c->position.data;
+        Vector2 *velocities = c->velocity.data;
+        for (int i = 0; i < NUM_MOVERS; i++) move(&positions[i], &velocities[i], dt);
+
+        update_entity_animations(manager, dt);
+    }
+    double new_time = get_time() - start;
+
+    print("    old Entity/Guy objects   %8.4fms\n", old_time / NUM_TICKS * 1000.0);
+    print("    Entity_Components        %8.4fms\n", new_time / NUM_TICKS * 1000.0);
+
+    // Both did the same movement, so they have to end up in the same places.
+    int num_mismatches = 0;
+    for (int i = 0; i < NUM_MOVERS; i++) {
+        Vector2 a = old_guys[i]->position;
+        Vector2 b = c->position[i];
+        if (a.x != b.x || a.y != b.y) num_mismatches += 1;
+    }
+    if (num_mismatches) print("    %d movers ended up somewhere else in the two layouts!\n", num_mismatches);
+
+    for (Old_Guy *guy : old_guys) delete guy;
+    delete manager;
+
+    fflush(stdout);
+    return num_mismatches == 0;
+}
+
+//
+// Jobs
+//
+
+const int JOB_BENCHMARK_EMPTY_JOBS = 1000 * 1000;
+const int JOB_BENCHMARK_EMPTY_JOBS_PER_WAIT = 1000; // Stays under the deque capacity.
+const int JOB_BENCHMARK_PARENTS = 2000;
+const int JOB_BENCHMARK_CHILDREN_PER_PARENT = 100;
+const int JOB_BENCHMARK_STAGES = 1000;
+const int JOB_BENCHMARK_JOBS_PER_STAGE = 100; // Every stage depends on the one before it.
+const int JOB_BENCHMARK_PARALLEL_FOR_COUNT = 4 * 1024 * 1024;
+const int JOB_BENCHMARK_PARALLEL_FOR_BATCH = 4096;
+const int JOB_BENCHMARK_WORK_PER_INDEX = 64; // Rounds of xorshift per parallel_for index.
+
+struct Job_Benchmark_Data {
+    std::atomic <s64> num_runs { 0 };
+    std::atomic <s64> num_children_run { 0 };
+    std::atomic <s64> num_stage_jobs_run { 0 };
+    std::atomic <s64> num_early_stage_jobs { 0 }; // Ran before the stage before theirs was done.
+    std::atomic <u8> *index_runs = NULL; // How many times each parallel_for index ran.
+    std::atomic <u32> checksum { 0 };
+};
+
+static void empty_job(void *data, int, int) {
+    ((Job_Benchmark_Data *)data)->num_runs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void child_job(void *data, int, int) {
+    ((Job_Benchmark_Data *)data)->num_children_run.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void parent_job(void *data, int, int) {
+    Job_Counter counter;
+    for (int i = 0; i < JOB_BENCHMARK_CHILDREN_PER_PARENT; i++) run_job(child_job, data, &counter);
+    wait_for_counter(&counter);
+
+    ((Job_Benchmark_Data *)data)->num_runs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// begin is the stage.
+static void stage_job(void *data, int begin, int) {
+    Job_Benchmark_Data *d = (Job_Benchmark_Data *)data;
+
+    s64 num_run = d->num_stage_jobs_run.fetch_add(1, std::memory_order_acq_rel);
+    if (num_run < (s64)begin * JOB_BENCHMARK_JOBS_PER_STAGE) d->num_early_stage_jobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void parallel_for_work(void *data, int begin, int end) {
+    Job_Benchmark_Data *d = (Job_Benchmark_Data *)data;
+
+    u32 checksum = 0;
+    for (int i = begin; i < end; i++) {
+        u32 x = (u32)i + 1;
+        for (int j = 0; j < JOB_BENCHMARK_WORK_PER_INDEX; j++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        checksum += x;
+        d->index_runs[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    d->checksum.fetch_add(checksum, std::memory_order_relaxed);
+}
+
+bool benchmark_jobs(int max_workers) {
+    if (max_workers < 0) max_workers = Max((int)std::thread::hardware_concurrency() - 1, 0);
+
+    Job_Benchmark_Data data;
+    data.index_runs = new std::atomic <u8>[JOB_BENCHMARK_PARALLEL_FOR_COUNT];
+    defer { delete [] data.index_runs; };
+
+    bool ok = true;
+    double single_thread_time = 0.0;
+    u32 single_thread_checksum = 0;
+
+    print("Jobs, for 0 to %d workers:\n", max_workers);
+    print("    workers  empty job  nested job  staged job  parallel_for  speedup\n");
+
+    for (int num_workers = 0; num_workers <= max_workers; num_workers++) {
+        init_job_system(num_workers);
+
+        // Empty jobs, waited on a thousand at a time.
+        data.num_runs = 0;
+        double start = get_time();
+        for (int i = 0; i < JOB_BENCHMARK_EMPTY_JOBS; i += JOB_BENCHMARK_EMPTY_JOBS_PER_WAIT) {
+            Job_Counter counter;
+            for (int j = 0; j < JOB_BENCHMARK_EMPTY_JOBS_PER_WAIT; j++) run_job(empty_job, &data, &counter);
+            wait_for_counter(&counter);
+        }
+        double empty_time = get_time() - start;
+
+        if (data.num_runs != JOB_BENCHMARK_EMPTY_JOBS) {
+            print("    %d workers ran %lld of %d empty jobs!\n", num_workers, (long long)data.num_runs.load(), JOB_BENCHMARK_EMPTY_JOBS);
+            ok = false;
+        }
+
+        // Jobs that run jobs and wait for them with counters of their own.
+        data.num_runs = 0;
+        data.num_children_run = 0;
+        start = get_time();
+        {
+            Job_Counter counter;
+            for (int i = 0; i < JOB_BENCHMARK_PARENTS; i++) run_job(parent_job, &data, &counter);
+            wait_for_counter(&counter);
+        }
+        double nested_time = get_time() - start;
+
+        s64 num_children = (s64)JOB_BENCHMARK_PARENTS * JOB_BENCHMARK_CHILDREN_PER_PARENT;
+        if (data.num_runs != JOB_BENCHMARK_PARENTS || data.num_children_run != num_children) {
+            print("    %d workers ran %lld of %d parents and %lld of %lld children!\n", num_workers,
+                  (long long)data.num_runs.load(), JOB_BENCHMARK_PARENTS, (long long)data.num_children_run.load(), (long long)num_children);
+            ok = false;
+        }
+
+        // Stages of jobs, each held back until the one before it is done. All of them get
+        // submitted up front, so it's the dependencies that keep them in order.
+        data.num_stage_jobs_run = 0;
+        data.num_early_stage_jobs = 0;
+        start = get_time();
+        {
+            Job_Counter *stages = new Job_Counter[JOB_BENCHMARK_STAGES];
+            for (int stage = 0; stage < JOB_BENCHMARK_STAGES; stage++) {
+                Job_Counter *depends_on = stage ? &stages[stage - 1] : NULL;
+                for (int i = 0; i < JOB_BENCHMARK_JOBS_PER_STAGE; i++) run_job(stage_job, &data, &stages[stage], stage, stage, depends_on);
+            }
+            wait_for_counter(&stages[JOB_BENCHMARK_STAGES - 1]);
+            for (int stage = 0; stage < JOB_BENCHMARK_STAGES; stage++) wait_for_counter(&stages[stage]);
+            delete [] stages;
+        }
+        double staged_time = get_time() - start;
+
+        s64 num_stage_jobs = (s64)JOB_BENCHMARK_STAGES * JOB_BENCHMARK_JOBS_PER_STAGE;
+        if (data.num_stage_jobs_run != num_stage_jobs || data.num_early_stage_jobs) {
+            print("    %d workers ran %lld of %lld staged jobs, %lld of them before their dependencies!\n", num_workers,
+                  (long long)data.num_stage_jobs_run.load(), (long long)num_stage_jobs, (long long)data.num_early_stage_jobs.load());
+            ok = false;
+        }
+
+        // parallel_for over the same work every time.
+        for (int i = 0; i < JOB_BENCHMARK_PARALLEL_FOR_COUNT; i++) data.index_runs[i].store(0, std::memory_order_relaxed);
+        data.checksum = 0;
+        start = get_time();
+        parallel_for(JOB_BENCHMARK_PARALLEL_FOR_COUNT, JOB_BENCHMARK_PARALLEL_FOR_BATCH, parallel_for_work, &data);
+        double parallel_for_time = get_time() - start;
+
+        int num_wrong = 0;
+        for (int i = 0; i < JOB_BENCHMARK_PARALLEL_FOR_COUNT; i++) {
+            if (data.index_runs[i].load(std::memory_order_relaxed) != 1) num_wrong += 1;
+        }
+        if (num_wrong) {
+            print("    %d workers: %d parallel_for indices didn't run exactly once!\n", num_workers, num_wrong);
+            ok = false;
+        }
+
+        if (num_workers == 0) {
+            single_thread_time = parallel_for_time;
+            single_thread_checksum = data.checksum;
+        } else if (data.checksum != single_thread_checksum) {
+            print("    %d workers: parallel_for computed something else than without workers!\n", num_workers);
+            ok = false;
+        }
+
+        shutdown_job_system();
+
+        s64 num_nested_jobs = JOB_BENCHMARK_PARENTS + num_children;
+        print("    %7d  %7.1fns  %8.1fns  %8.1fns  %10.3fms  %6.2fx\n", num_workers,
+              ns_per_op(empty_time, JOB_BENCHMARK_EMPTY_JOBS), ns_per_op(nested_time, num_nested_jobs), ns_per_op(staged_time, num_stage_jobs),
+              parallel_for_time * 1000.0, single_thread_time / parallel_for_time);
+    }
+
+    fflush(stdout);
+    return ok;
+}
+
+// From no workers up to one per extra hardware thread.
+static bool benchmark_jobs_up_to_all_threads() {
+    return benchmark_jobs(-1);
+}
+
+//
+// Sprite vertices
+//
+
+struct Vertex_Benchmark_Sprite {
+    Vector2 p0; // Bottom left.
+    Vector2 p2; // Top right.
+    Vector2 uv0;
+    Vector2 uv1;
+    Vector4 color;
+    u32 packed_color; // What Sprite_Batch keeps instead of color.
+};
+
+// immediate_quad's vertices as they were before Vertex_Sprite: six Vertex_XCUNs per quad.
+inline void old_put_vertex(Vertex_XCUN *v, Vector2 position, Vector2 uv, Vector4 color) {
+    v->position = Vector3(position.x, position.y, 0);
+    v->color = color;
+    v->uv = uv;
+    v->normal = Vector3(0, 0, 1);
+}
+
+inline void old_put_quad(Vertex_XCUN *v, Vertex_Benchmark_Sprite *s) {
+    Vector2 p1(s->p2.x, s->p0.y);
+    Vector2 p3(s->p0.x, s->p2.y);
+    Vector2 uv1(s->uv1.x, s->uv0.y);
+    Vector2 uv3(s->uv0.x, s->uv1.y);
+
+    old_put_vertex(&v[0], s->p0, s->uv0, s->color);
+    old_put_vertex(&v[1], p1, uv1, s->color);
+    old_put_vertex(&v[2], s->p2, s->uv1, s->color);
+
+    old_put_vertex(&v[3], s->p0, s->uv0, s->color);
+    old_put_vertex(&v[4], s->p2, s->uv1, s->color);
+    old_put_vertex(&v[5], p3, uv3, s->color);
+}
+
+bool benchmark_sprite_vertices() {
+    const int SIZES[] = { 1000, 100 * 1000 };
+    const int MAX_QUADS = 100 * 1000;
+    bool ok = true;
+
+    Array <Vertex_Benchmark_Sprite> sprites;
+    sprites.reserve(MAX_QUADS);
+    u32 random_state = 12345;
+    for (int i = 0; i < MAX_QUADS; i++) {
+        random_state = random_state * 1664525u + 1013904223u;
+        float x = (float)(random_state >> 8) / (float)(1 << 24) * 1024.0f;
+        random_state = random_state * 1664525u + 1013904223u;
+        float y = (float)(random_state >> 8) / (float)(1 << 24) * 1024.0f;
+
+        Vertex_Benchmark_Sprite s;
+        s.p0 = Vector2(x, y);
+        s.p2 = Vector2(x + 1, y + 2);
+        s.uv0 = Vector2((i % 16) / 16.0f, 0.25f);
+        s.uv1 = Vector2((i % 16 + 1) / 16.0f, 0.5f);
+        s.color = Vector4(1, (i % 256) / 255.0f, 0.5f, 1);
+        s.packed_color = pack_rgba8(s.color);
+        sprites.add(s);
+    }
+
+    Vertex_XCUN *xcun_vertices = new Vertex_XCUN[MAX_QUADS * 6];
+    Vertex_Sprite *sprite_vertices = new Vertex_Sprite[MAX_QUADS * 4];
+    Sprite_Instance *instances = new Sprite_Instance[MAX_QUADS];
+    defer {
+        delete [] xcun_vertices;
+        delete [] sprite_vertices;
+        delete [] instances;
+    };
+
+    s64 xcun_bytes = 6 * sizeof(Vertex_XCUN);
+    s64 sprite_bytes = 4 * sizeof(Vertex_Sprite);
+    s64 instance_bytes = sizeof(Sprite_Instance);
+
+    print("Writing sprite quads on the CPU, per quad (bytes per quad, speedup over Vertex_XCUN):\n");
+    print("    %9s  %-24s  %-24s  %s\n", "quads", "6 Vertex_XCUN", "4 Vertex_Sprite", "Sprite_Instance");
+
+    for (int num_quads : SIZES) {
+        int num_rounds = get_num_rounds(num_quads);
+        s64 num_ops = (s64)num_quads * num_rounds;
+
+        double start = get_time();
+        for (int round = 0; round < num_rounds; round++) {
+            for (int i = 0; i < num_quads; i++) old_put_quad(&xcun_vertices[i * 6], &sprites[i]);
+        }
+        double xcun_time = get_time() - start;
+
+        start = get_time();
+        for (int round = 0; round < num_rounds; round++) {
+            for (int i = 0; i < num_quads; i++) {
+                Vertex_Benchmark_Sprite *s = &sprites[i];
+                put_sprite_quad(&sprite_vertices[i * 4], s->p0, s->p2, s->uv0, s->uv1, s->packed_color);
+            }
+        }
+        double sprite_time = get_time() - start;
+
+        start = get_time();
+        for (int round = 0; round < num_rounds; round++) {
+            for (int i = 0; i < num_quads; i++) {
+                Vertex_Benchmark_Sprite *s = &sprites[i];
+                put_sprite_instance(&instances[i], s->p0, s->p2 - s->p0, s->uv0, s->uv1, s->packed_color);
+            }
+        }
+        double instance_time = get_time() - start;
+
+        // The top right corner has to come out of every format where it went in.
+        int num_wrong = 0;
+        for (int i = 0; i < num_quads; i++) {
+            Vertex_Benchmark_Sprite *s = &sprites[i];
+            Vertex_XCUN *x = &xcun_vertices[i * 6 + 2];
+            Vertex_Sprite *v = &sprite_vertices[i * 4 + 2];
+            Sprite_Instance *instance = &instances[i];
+            if (x->position.x != s->p2.x || x->position.y != s->p2.y || x->uv.x != s->uv1.x) num_wrong += 1;
+            else if (v->position.x != s->p2.x || v->position.y != s->p2.y || v->uv[0] != pack_unorm16(s->uv1.x) || v->color != s->packed_color) num_wrong += 1;
+            else if (instance->position.x + instance->size.x != s->p2.x || instance->uv1[0] != pack_unorm16(s->uv1.x)) num_wrong += 1;
+        }
+        if (num_wrong) {
+            print("    %d of %d quads came out wrong!\n", num_wrong, num_quads);
+            ok = false;
+        }
+
+        double xcun_ns = ns_per_op(xcun_time, num_ops);
+        double sprite_ns = ns_per_op(sprite_time, num_ops);
+        double instance_ns = ns_per_op(instance_time, num_ops);
+        print("    %9d  %7.2fns (%3lld B)         %7.2fns (%3lld B) %5.2fx  %7.2fns (%3lld B) %5.2fx\n", num_quads,
+              xcun_ns, (long long)xcun_bytes,
+              sprite_ns, (long long)sprite_bytes, xcun_ns / sprite_ns,
+              instance_ns, (long long)instance_bytes, xcun_ns / instance_ns);
+    }
+
+    fflush(stdout);
+    return ok;
+}
+
+//
+// Lookup
+//
+
+Benchmark benchmarks[] = {
+    { "hash_table", benchmark_hash_table },
+    { "array", benchmark_array },
+    { "entity_components", benchmark_entity_components },
+    { "jobs", benchmark_jobs_up_to_all_threads },
+    { "sprite_vertices", benchmark_sprite_vertices },
+};
+
+extern const int NUM_BENCHMARKS = ArrayCount(benchmarks);
+
+Benchmark *find_benchmark(char *name) {
+    for (int i = 0; i < NUM_BENCHMARKS; i++) {
+        if (strings_match(benchmarks[i].name, name)) return &benchmarks[i];
+    }
+    return NULL;
+}
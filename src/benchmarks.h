@@ -0,0 +1,39 @@
+#pragma once
+
+//
+// Microbenchmarks, run with -bench name instead of the game, by main or by the headless
+// runner. Each one prints its timings and returns false if something came out wrong.
+//
+
+struct Benchmark {
+    char *name;
+    bool (*proc)();
+};
+
+extern Benchmark benchmarks[];
+extern const int NUM_BENCHMARKS;
+
+Benchmark *find_benchmark(char *name); // NULL if there is none by that name.
+
+// Insert, find-hit, find-miss and erase at 1k, 100k and 10M keys, next to the table that
+// Hash_Table replaced.
+bool benchmark_hash_table();
+
+// Filling 10M elements with add and with add_range, iterating them, and swap-removing all of
+// them from random places.
+bool benchmark_array();
+
+// Per-tick cost of moving and animating 100k movers, with the entity fields in the old
+// Entity/Guy objects and in Entity_Components.
+bool benchmark_entity_components();
+
+// Job system overhead and scaling, once for every worker count from 0 to max_workers (< 0
+// means one per extra hardware thread): dispatching empty jobs, jobs that run and wait for
+// jobs of their own, stages of jobs that depend on the stage before, and parallel_for over a
+// fixed amount of work. -bench jobs goes up to one
+// worker per extra hardware thread.
+bool benchmark_jobs(int max_workers);
+
+// Writing sprite quads into a vertex buffer on the CPU, as the six Vertex_XCUNs immediate_quad
+// used to write, as the four Vertex_Sprites it writes now, and as one Sprite_Instance.
+bool benchmark_sprite_vertices();
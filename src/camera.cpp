@@ -25,12 +25,18 @@ void Camera::update(float dt) {
     }
 }
 
+Vector2 Camera::get_render_position() {
+    return lerp(previous_position, position, globals.render_alpha);
+}
+
 Matrix4 Camera::get_matrix() {
+    Vector2 render_position = get_render_position();
+
     Matrix4 result;
     result.identity();
 
-    result._14 = -position.x;
-    result._24 = -position.y;
+    result._14 = -render_position.x;
+    result._24 = -render_position.y;
     
     return result;
 }
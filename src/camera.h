@@ -4,10 +4,12 @@
 
 struct Camera {
     Vector2 position = Vector2(0, 0);
+    Vector2 previous_position = Vector2(0, 0);
     float zoom_t_target = 1.0f;
     float zoom_t = 1.0f;
     
     void handle_zoom(int delta);
     void update(float dt);
+    Vector2 get_render_position(); // Between previous_position and position, by globals.render_alpha.
     Matrix4 get_matrix();
 };
@@ -10,6 +10,11 @@
 #include "hud.h"
 
 #include "texture_registry.h"
+#include "sprite_batch.h"
+#include "tilemap_mesh.h"
+#include "tilemap_collision.h"
+#include "light_bins.h"
+#include "shadow_segments.h"
 
 void rendering_2d_right_handed(int width, int height) {
     Matrix4 m;
@@ -55,21 +60,53 @@ void draw_text(Dynamic_Font *font, char *text, int x, int y, Vector4 color) {
     }
     immediate_flush();
 
-    font->font_quads.count = 0;
+    font->font_quads.clear();
 }
 
-void set_matrix_for_entities(Entity_Manager *manager) {
+Culling_Stats culling_stats;
+Light_Bins light_bins;
+
+// Sprites and lights this close to the edge of the view still get drawn.
+const float CULL_MARGIN = 0.5f;
+
+// Half the size of the part of the world set_matrix_for_entities puts on screen.
+static Vector2 get_view_half_size(Entity_Manager *manager) {
     Tilemap *tm = manager->tilemap;
     Camera *camera = manager->camera;
     
     float half_width = 0.5f * tm->width;
     float half_height = 0.5f  * tm->height;
+
+    return Vector2(half_width * camera->zoom_t, half_height * camera->zoom_t);
+}
+
+void set_matrix_for_entities(Entity_Manager *manager) {
+    Camera *camera = manager->camera;
+    Vector2 half_size = get_view_half_size(manager);
     
-    global_parameters.proj_matrix = make_orthographic(-half_width * camera->zoom_t, half_width * camera->zoom_t, -half_height * camera->zoom_t, half_height * camera->zoom_t);
+    global_parameters.proj_matrix = make_orthographic(-half_size.x, half_size.x, -half_size.y, half_size.y);
     global_parameters.view_matrix = camera->get_matrix();
     global_parameters.transform = global_parameters.proj_matrix * global_parameters.view_matrix;    
 }
 
+Rectangle2 get_visible_world_rect(Entity_Manager *manager) {
+    Vector2 half_size = get_view_half_size(manager);
+    Vector2 center = manager->camera->get_render_position();
+
+    Rectangle2 result;
+    result.x = center.x - half_size.x;
+    result.y = center.y - half_size.y;
+    result.width = half_size.x * 2.0f;
+    result.height = half_size.y * 2.0f;
+    return result;
+}
+
+static bool is_visible(Rectangle2 view, Vector2 min, Vector2 max) {
+    if (max.x < view.x - CULL_MARGIN || min.x > view.x + view.width + CULL_MARGIN) return false;
+    if (max.y < view.y - CULL_MARGIN || min.y > view.y + view.height + CULL_MARGIN) return false;
+    return true;
+}
+
 static Shader *get_shader_for_entity(Entity *e) {
     switch (e->type) {
         case ENTITY_TYPE_TILEMAP: return globals.shader_tile;
@@ -79,122 +116,123 @@ static Shader *get_shader_for_entity(Entity *e) {
         case ENTITY_TYPE_ENEMY:
         case ENTITY_TYPE_THUMBLEWEED:
             return globals.shader_guy;
+
+        case ENTITY_TYPE_LIGHT_SOURCE: return NULL; // Lights go through draw_lights, not the sprite batch.
     }
 
     return NULL;
 }
 
-static void draw_tilemap(Tilemap *tm) {
-    immediate_begin();
-    float xpos = tm->position.x;
-    float ypos = tm->position.y;
-    
-    Texture *last_texture = NULL;
-    
-    for (int y = 0; y < tm->height; y++) {
-        for (int x = 0; x < tm->width; x++) {
-            Tile *tile = &tm->tiles[y * tm->width + x];
-            if (tile->id) {
-                Texture *texture = tm->textures[tile->id-1];
-                if (texture != last_texture) {
-                    immediate_flush();
-                    set_texture(0, texture);
-                    last_texture = texture;
-                }
-                        
-                Vector2 position(xpos, ypos);
-                Vector2 size(1, 1);
-
-                float hw = size.x * 0.5f;
-                float hh = size.y * 0.5f;
-
-                Vector2 center(position.x + hw, position.y + hh);
-                        
-                Vector2 p0 = center + Vector2(-hw, -hh);
-                Vector2 p1 = center + Vector2(+hw, -hh);
-                Vector2 p2 = center + Vector2(+hw, +hh);
-                Vector2 p3 = center + Vector2(-hw, +hh);
-                            
-                Vector2 uv0(0, 0);
-                Vector2 uv1(1, 0);
-                Vector2 uv2(1, 1);
-                Vector2 uv3(0, 1);
-                
-                Vector4 color(1, 1, 1, 1);
-                
-                immediate_quad(p0, p1, p2, p3, uv0, uv1, uv2, uv3, color);
-            }
-            xpos += 1.0f;
-        }
-        xpos = tm->position.x;
-        ypos += 1.0f;
-    }
-    immediate_flush();
+// Where to draw e this frame: between its last two positions, by globals.render_alpha.
+static Vector2 get_render_position(Entity *e) {
+    return lerp(e->previous_position(), e->position(), globals.render_alpha);
 }
 
-static void draw_entity(Entity *e) {
-    auto shader = get_shader_for_entity(e);
-    if (!shader) return;
-    
-    set_shader(shader);
-    
-    if (e->type == ENTITY_TYPE_TILEMAP) {
-        draw_tilemap((Tilemap *)e);
-        return;
-    }
-    
-    Animation *animation = e->current_animation;
-    if (!animation) return;
+enum Sprite_Layer {
+    SPRITE_LAYER_ENTITIES,
+};
 
-    Texture *texture = animation->get_current_frame();
-    if (!texture) return;
+static Sprite_Batch main_scene_batch;
 
-    set_texture(0, texture);
+// One pass over entities of one type, reading their component rows directly. Their depth is
+// the y they are drawn at, so entities farther up are farther away and get drawn first.
+template <typename T>
+static void add_entity_sprites(Sprite_Batch *batch, Rectangle2 view, Array <T *> &entities, int layer) {
+    if (!entities.count) return;
 
-    Vector2 position = e->position;
-    Vector2 size = e->size;
-        
-    float hw = size.x * 0.5f;
-    float hh = size.y * 0.5f;
-        
-    Vector2 center = position + Vector2(hw, hh);
+    // Every entity of a type uses the same shader.
+    auto shader = get_shader_for_entity(entities[0]);
+    if (!shader) return;
 
-    Vector2 p0 = center + Vector2(-hw, -hh);
-    Vector2 p1 = center + Vector2(+hw, -hh);
-    Vector2 p2 = center + Vector2(+hw, +hh);
-    Vector2 p3 = center + Vector2(-hw, +hh);
+    Entity_Components *c = &entities[0]->manager->components;
+    Vector2 *positions = c->position.data;
+    Vector2 *previous_positions = c->previous_position.data;
+    Vector2 *sizes = c->size.data;
+    Animation **animations = c->current_animation.data;
+    int *frames = c->animation_frame.data;
+
+    float alpha = globals.render_alpha;
+    u32 white = pack_rgba8(Vector4(1, 1, 1, 1));
+
+    batch->reserve(entities.count);
+
+    // Entities next to each other mostly show the same frame, so its region only gets looked
+    // up and packed into an instance when it changes. Each sprite then just copies that in and
+    // sets its position and size.
+    Animation *last_animation = NULL;
+    int last_frame = -1;
+    Texture_Region *region = NULL;
+    Sprite_Instance region_instance = {};
+
+    int num_submitted = 0;
+    int num_culled = 0;
+    for (T *e : entities) {
+        int row = e->component_index;
+
+        // Between its last two positions, like get_render_position.
+        Vector2 position = lerp(previous_positions[row], positions[row], alpha);
+        Vector2 size = sizes[row];
+        if (!is_visible(view, position, position + size)) {
+            num_culled += 1;
+            continue;
+        }
 
-    Vector2 uv0(0, 0);
-    Vector2 uv1(1, 0);
-    Vector2 uv2(1, 1);
-    Vector2 uv3(0, 1);
+        Animation *animation = animations[row];
+        if (!animation) continue;
 
-    Vector4 color(1, 1, 1, 1);
-    
-    immediate_begin();
-    immediate_quad(p0, p1, p2, p3, uv0, uv1, uv2, uv3, color);
-    immediate_flush();
-}
+        int frame = frames[row];
+        if (animation != last_animation || frame != last_frame) {
+            last_animation = animation;
+            last_frame = frame;
 
-static int tree_cmp_func(const void *a, const void *b) {
-    Tree *t1 = (Tree *)a;
-    Tree *t2 = (Tree *)b;
+            region = animation->get_frame(frame);
+            if (region) put_sprite_instance(&region_instance, Vector2(0, 0), Vector2(0, 0), region->uv0, region->uv1, white);
+        }
+        if (!region) continue;
 
-    if (t2->position.y > t1->position.y) return 1;
-    else if (t2->position.y < t1->position.y) return -1;
-    return 0;
+        Sprite_Instance *sprite = batch->add(layer, position.y, shader, region->texture);
+        *sprite = region_instance;
+        sprite->position = position;
+        sprite->size = size;
+
+        num_submitted += 1;
+    }
+
+    culling_stats.sprites_submitted += num_submitted;
+    culling_stats.sprites_culled += num_culled;
 }
 
 void draw_main_scene(Entity_Manager *manager) {
+    Sprite_Batch *batch = &main_scene_batch;
+    Rectangle2 view = get_visible_world_rect(manager);
+
+    culling_stats.chunks_drawn = 0;
+    culling_stats.chunks_culled = 0;
+    culling_stats.sprites_submitted = 0;
+    culling_stats.sprites_culled = 0;
+    sprite_sort_stats = Sprite_Sort_Stats();
+    
+    // Under everything else, so it doesn't need to go through the batch.
     auto tm = manager->tilemap;
-    if (tm) draw_entity(tm);
+    if (tm) {
+        c2AABB view_aabb;
+        view_aabb.min = c2V(view.x, view.y);
+        view_aabb.max = c2V(view.x + view.width, view.y + view.height);
+        Tile_Range visible_tiles = get_overlapped_tile_range(tm, view_aabb);
+
+        int num_chunks_x = (tm->width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+        int num_chunks_y = (tm->height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+        culling_stats.chunks_drawn = draw_tilemap_chunks(tm, get_shader_for_entity(tm), visible_tiles);
+        culling_stats.chunks_culled = num_chunks_x * num_chunks_y - culling_stats.chunks_drawn;
+    }
 
-    for (Thumbleweed *tw : manager->by_type._Thumbleweed) draw_entity(tw);
-    for (Enemy *enemy : manager->by_type._Enemy) draw_entity(enemy);
-    for (Guy *guy : manager->by_type._Guy) draw_entity(guy);
+    // All in one layer, so that the guy walks in front of the trees below it and behind the ones above.
+    add_entity_sprites(batch, view, manager->by_type._Thumbleweed, SPRITE_LAYER_ENTITIES);
+    add_entity_sprites(batch, view, manager->by_type._Enemy, SPRITE_LAYER_ENTITIES);
+    add_entity_sprites(batch, view, manager->by_type._Guy, SPRITE_LAYER_ENTITIES);
+    add_entity_sprites(batch, view, manager->by_type._Tree, SPRITE_LAYER_ENTITIES);
 
-    qsort(manager->by_type._Tree.data, manager->by_type._Tree.count, sizeof(Tree *), tree_cmp_func);
-    for (Tree *tree : manager->by_type._Tree) draw_entity(tree);
+    batch->draw();
 }
 
 void resolve_to_screen() {
@@ -239,46 +277,119 @@ static Vector4 to_vec4(Vector3 v) {
     return Vector4(v.x, v.y, v.z, 1.0f);
 }
 
-void draw_circle(Vector2 center, float radius, Vector4 color) {
-    const int NUM_TRIANGLES = 100;
-    auto dtheta = TAU / NUM_TRIANGLES;
-    float r = radius;
-
-    for (int i = 0; i < NUM_TRIANGLES; i++) {
-        auto theta0 = i * dtheta;
-        auto theta1 = (i+1) * dtheta;
-        
-        auto v0 = get_vec2(theta0);
-        auto v1 = get_vec2(theta1);
-
-        auto p0 = center;
-        auto p1 = center + r * v0;
-        auto p2 = center + r * v1;
-
-        immediate_triangle(p0, p1, p2, color);
-    }
+// The pixels of the render target that the world rectangle min..max covers, for set_scissor (which counts y from the top).
+static Rectangle2i get_scissor_rect(Rectangle2 view, Vector2 min, Vector2 max) {
+    float sx = globals.render_width / view.width;
+    float sy = globals.render_height / view.height;
+
+    int x0 = Clamp((int)floorf((min.x - view.x) * sx), 0, globals.render_width);
+    int x1 = Clamp((int)ceilf((max.x - view.x) * sx), 0, globals.render_width);
+    int y0 = Clamp((int)floorf((view.y + view.height - max.y) * sy), 0, globals.render_height);
+    int y1 = Clamp((int)ceilf((view.y + view.height - min.y) * sy), 0, globals.render_height);
+
+    Rectangle2i result;
+    result.x = x0;
+    result.y = y0;
+    result.width = x1 - x0;
+    result.height = y1 - y0;
+    return result;
 }
 
+struct Shadowed_Light {
+    Light_Source *source;
+    Vector2 center;
+    Light_Shadow *shadow;
+};
+
 void draw_lights() {
     auto manager = get_entity_manager();
     set_matrix_for_entities(manager);
     refresh_global_parameters();
 
+    Rectangle2 view = get_visible_world_rect(manager);
+    culling_stats.lights_submitted = 0;
+    culling_stats.lights_culled = 0;
+    shadow_stats = Shadow_Stats();
+
+    Array <Vector2> centers;
+    centers.use_temporary_storage = true;
+    Array <float> radii;
+    radii.use_temporary_storage = true;
+    Array <Shadowed_Light> shadowed_lights;
+    shadowed_lights.use_temporary_storage = true;
+
+    // One quad per light, light.hlsl works out the falloff from the uvs. It adds its color
+    // weighted by the lightmap alpha and leaves the alpha alone, so lights that nothing casts a
+    // shadow into can overlap freely in one draw. The others get drawn one by one below.
+    set_shader(globals.shader_light);
     immediate_begin();
     for (Light_Source *source : manager->by_type._Light_Source) {        
-        set_shader(globals.shader_light);
-        draw_circle(source->position, source->radius, to_vec4(source->color));
+        Vector2 center = get_render_position(source);
+        Vector2 extent(source->radius, source->radius);
+        if (!is_visible(view, center - extent, center + extent)) {
+            culling_stats.lights_culled += 1;
+            continue;
+        }
+
+        culling_stats.lights_submitted += 1;
+        centers.add(center);
+        radii.add(source->radius);
+
+        Light_Shadow *shadow = get_light_shadow(manager, source, center);
+        if (shadow->vertex_buffer) {
+            Shadowed_Light shadowed = { source, center, shadow };
+            shadowed_lights.add(shadowed);
+            continue;
+        }
+        
+        immediate_sprite_quad(center - extent, center + extent, Vector2(0, 0), Vector2(1, 1), pack_rgba8(to_vec4(source->color)));
     }
     immediate_flush();
+
+    // The shadows zero the alpha of the lightmap behind the occluders, and the light is drawn
+    // weighted by that alpha. Everything is scissored to the light, so that putting the alpha
+    // back to 1 only has to cover the light too.
+    for (Shadowed_Light &it : shadowed_lights) {
+        Vector2 extent(it.source->radius, it.source->radius);
+        Vector2 min = it.center - extent;
+        Vector2 max = it.center + extent;
+
+        Rectangle2i scissor = get_scissor_rect(view, min, max);
+        if (scissor.width <= 0 || scissor.height <= 0) continue;
+        set_scissor(scissor.x, scissor.y, scissor.width, scissor.height);
+
+        global_parameters.light_position = it.center;
+        refresh_global_parameters();
+
+        set_shader(globals.shader_shadow_segments);
+        draw_vertex_buffer(it.shadow->vertex_buffer);
+
+        set_shader(globals.shader_light);
+        immediate_sprite_quad(min, max, Vector2(0, 0), Vector2(1, 1), pack_rgba8(to_vec4(it.source->color)));
+        immediate_flush();
+
+        set_shader(globals.shader_alpha_clear);
+        immediate_quad(min.x, min.y, max.x, max.y, Vector4(0, 0, 0, 1));
+        immediate_flush();
+
+        shadow_stats.lights_with_shadows += 1;
+        shadow_stats.edges_drawn += it.shadow->num_edges;
+    }
+    if (shadowed_lights.count) set_scissor(0, 0, globals.render_width, globals.render_height);
+    
+    end_light_shadow_frame();
+
+    bin_lights(&light_bins, view, globals.render_width, globals.render_height, centers.data, radii.data, centers.count);
 }
 
 void draw_one_frame() {
+    get_entity_manager()->save_new_previous_positions();
+
     set_render_targets(the_lightmap_buffer, NULL);
     clear_color_target(the_lightmap_buffer, 19/255.0f, 24/255.0f, 98/255.0f, 1.0f);
     set_viewport(0, 0, globals.render_width, globals.render_height);
     set_scissor(0, 0, globals.render_width, globals.render_height);
 
-    globals.render_type = RENDER_TYPE_LIGHTS;
     draw_lights();
     
     set_render_targets(the_offscreen_buffer, NULL);
@@ -290,7 +401,6 @@ void draw_one_frame() {
     set_matrix_for_entities(manager);
     refresh_global_parameters();
 
-    globals.render_type = RENDER_TYPE_MAIN;
     draw_main_scene(manager);
     
     resolve_to_screen();
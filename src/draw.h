@@ -6,11 +6,27 @@ struct Entity_Manager;
 void rendering_2d_right_handed(int width, int height);
 void draw_text(Dynamic_Font *font, char *text, int x, int y, Vector4 color);
 
+// What get_visible_world_rect left out of the last frame. Chunks are tilemap chunks (see tilemap_mesh.h).
+struct Culling_Stats {
+    int chunks_drawn = 0;
+    int chunks_culled = 0;
+    int sprites_submitted = 0;
+    int sprites_culled = 0;
+    int lights_submitted = 0;
+    int lights_culled = 0;
+};
+
+extern Culling_Stats culling_stats;
+
+struct Light_Bins;
+extern Light_Bins light_bins; // The lights draw_lights drew last frame, binned into screen tiles (see light_bins.h).
+
 void set_matrix_for_entities(Entity_Manager *manager);
+
+// The part of the world set_matrix_for_entities puts on screen.
+Rectangle2 get_visible_world_rect(Entity_Manager *manager);
 void draw_main_scene(Entity_Manager *manager);
 void resolve_to_screen();
 
-void draw_circle(Vector2 center, float radius, Vector4 color);
-
 void draw_lights();
 void draw_one_frame();
@@ -26,6 +26,7 @@ void update_editor() {
     }
     
     auto manager = get_entity_manager();
+    manager->update_spatial_grid(); // The editor moves things without simulating.
     
     if (is_key_pressed(MOUSE_BUTTON_LEFT)) {
         int x, y;
@@ -48,15 +49,14 @@ void update_editor() {
         nx -= globals.world_space_size_x * 0.5f;
         ny -= globals.world_space_size_y * 0.5f;
 
-        int entity_id = -1;
+        Array <Entity *> hits;
+        hits.use_temporary_storage = true;
+        manager->grid.query_point(Vector2(nx, ny), &hits);
 
-        for (int i = manager->all_entities.count-1; i >= 0; i--) {
-            Entity *e = manager->all_entities[i];
-            if (nx >= e->position.x && ny >= e->position.y &&
-                nx <= e->position.x + e->size.x && ny <= e->position.y + e->size.y) {
-                entity_id = e->id;
-                break;
-            }
+        // Pick the most recently made one, ids are handed out in creation order.
+        int entity_id = -1;
+        for (Entity *e : hits) {
+            if (e->id > entity_id) entity_id = e->id;
         }
         
         currently_selected_entity_id = entity_id;
@@ -68,7 +68,7 @@ void update_editor() {
             if (!e) return;
             
             Vector2 mpos = screen_space_to_world_space(mouse_x_offset, mouse_y_offset, false);
-            e->position += mpos;
+            e->position() += mpos;
         }
     }
 
@@ -77,7 +77,7 @@ void update_editor() {
             auto e = manager->get_entity_by_id(currently_selected_entity_id);
             if (e) {
                 auto copied = manager->add_entity(e);
-                currently_selected_entity_id = copied->id;
+                if (copied) currently_selected_entity_id = copied->id;
             }
         }
     }
@@ -90,13 +90,13 @@ static void draw_outline_around_entity(int entity_id) {
     
     Vector4 color(0, 1, 0, 1);
 
-    Vector2 position = e->position;
+    Vector2 position = e->position();
     
-    float horizontal_line_width = e->size.x;//1.0f;
+    float horizontal_line_width = e->size().x;//1.0f;
     float horizontal_line_height = 0.01f;
     float vertical_line_width = 0.01f;
     //float vertical_line_height = 1.0f - 2.0f*horizontal_line_height;
-    float vertical_line_height = e->size.y - 2.0f*horizontal_line_height;
+    float vertical_line_height = e->size().y - 2.0f*horizontal_line_height;
     
     immediate_begin();
     
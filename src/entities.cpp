@@ -1,15 +1,16 @@
 #include "pch.h"
 #include "entities.h"
 #include "entity_manager.h"
+#include "tilemap_collision.h"
 #include "text_file_handler.h"
 #include "os.h"
 #include "game.h"
 #include "texture_registry.h"
 #include "animation.h"
+#include "jobs.h"
 
 bool load_tilemap(Tilemap *tilemap, char *name) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     char *full_path = tprint("data/tilemaps/%s.tm", name);
     if (!file_exists(full_path)) {
@@ -78,7 +79,7 @@ bool load_tilemap(Tilemap *tilemap, char *name) {
         return false;
     }
     
-    Texture **textures = new Texture*[num_textures];
+    Texture_Region **textures = new Texture_Region*[num_textures];
     int current_texture_index = 0;
 
     for (int i = 0; i < num_textures; i++) {
@@ -95,7 +96,7 @@ bool load_tilemap(Tilemap *tilemap, char *name) {
         line = eat_spaces(line);
         line = eat_trailing_spaces(line);
         
-        textures[current_texture_index] = globals.texture_registry->get(line);
+        textures[current_texture_index] = globals.texture_registry->get_region(line);
         current_texture_index++;
     }
 
@@ -126,6 +127,9 @@ bool load_tilemap(Tilemap *tilemap, char *name) {
     char **lines = new char *[height];
     defer { delete [] lines; };
 
+    bool *is_collidable = new bool[width * height];
+    defer { delete [] is_collidable; };
+
     for (int i = 0; i < height; i++) {
         lines[i] = handler.consume_next_line();
     }
@@ -144,7 +148,7 @@ bool load_tilemap(Tilemap *tilemap, char *name) {
 
             Tile *tile = &tiles[i * width + x];
             tile->id = tile_id;
-            tile->is_collidable = collidable_ids.find(tile_id) != -1;
+            is_collidable[i * width + x] = collidable_ids.find(tile_id) != -1;
         }
     }
 
@@ -157,19 +161,66 @@ bool load_tilemap(Tilemap *tilemap, char *name) {
 
     tilemap->num_textures = num_textures;
     tilemap->textures = textures;
+
+    build_tilemap_collision_bits(tilemap, is_collidable);
     
     return true;
 }
 
-void Entity::update_current_animation(float dt) {
-    if (current_animation) {
-        current_animation->update(dt);
-    }
+static void copy_animation_parameters(Entity_Components *components, int index) {
+    Animation *animation = components->current_animation[index];
+
+    // Without frames the rate is 0, so the phase never moves and frame 0 is all there is.
+    bool has_frames = animation && animation->frames && animation->num_frames > 0;
+    components->animation_rate[index] = has_frames ? animation->frames_per_second : 0.0f;
+    components->animation_num_frames[index] = has_frames ? animation->num_frames : 1;
+    components->animation_is_looping[index] = (has_frames && animation->is_looping) ? 1.0f : 0.0f;
 }
 
-void Guy::set_animation(Animation *animation) {
-    current_animation = animation;
-    current_animation->reset();
+void Entity::set_animation(Animation *animation) {
+    auto components = &manager->components;
+    components->current_animation[component_index] = animation;
+    components->animation_phase[component_index] = 0.0f;
+    components->animation_frame[component_index] = 0;
+    copy_animation_parameters(components, component_index);
+}
+
+// Rows per job. Fewer rows than this get updated on the calling thread without any jobs.
+const int ANIMATION_UPDATE_BATCH_SIZE = 16 * 1024;
+
+void update_entity_animations(Entity_Manager *manager, float dt) {
+    auto components = &manager->components;
+    int count = components->owner.count;
+
+    // A clip got hotloaded, its frame count or rate may be different now.
+    if (manager->animation_clip_generation != animation_clip_generation) {
+        for (int i = 0; i < count; i++) copy_animation_parameters(components, i);
+        manager->animation_clip_generation = animation_clip_generation;
+    }
+
+    float *phases = components->animation_phase.data;
+    int *frames = components->animation_frame.data;
+    float *rates = components->animation_rate.data;
+    int *num_frames = components->animation_num_frames.data;
+    float *is_looping = components->animation_is_looping.data;
+
+    // Branch-free so that the compiler can vectorize it. Looping animations wrap around, the
+    // others stay on their last frame. Rows don't depend on each other, so batches of them can
+    // go to the job system.
+    parallel_for(count, ANIMATION_UPDATE_BATCH_SIZE, [=](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            float n = (float)num_frames[i];
+            float phase = phases[i] + dt * rates[i];
+            float wrapped = phase - n * (float)(int)(phase / n);
+            float clamped = Min(phase, n);
+            phase = clamped + is_looping[i] * (wrapped - clamped);
+
+            int frame = (int)phase;
+            int last_frame = num_frames[i] - 1;
+            phases[i] = phase;
+            frames[i] = Min(frame, last_frame);
+        }
+    });
 }
 
 void Guy::set_state(Guy_State state) {
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "geometry.h"
+#include "entity_manager.h"
 
 #include <cute_c2.h>
 
-struct Entity_Manager;
 struct Texture;
+struct Texture_Region;
+struct Tilemap_Chunk;
+struct Tilemap_Shadow_Edges;
 
 struct Animation;
 
@@ -22,16 +25,26 @@ enum Entity_Type {
 struct Entity {
     Entity_Type type;
     int id;
+    Entity_Handle handle;
     Entity_Manager *manager;
-    
-    Vector2 position;
-    Vector2 size;
 
-    Animation *current_animation;
+    int component_index; // Row in manager->components, see Entity_Components.
+    int type_index; // Index in the manager's by_type array for this type.
+    int all_entities_index;
+    bool scheduled_for_destruction;
+
+    inline Vector2 &position() { return manager->components.position[component_index]; }
+    inline Vector2 &previous_position() { return manager->components.previous_position[component_index]; }
+    inline Vector2 &size() { return manager->components.size[component_index]; }
+    inline Vector2 &velocity() { return manager->components.velocity[component_index]; }
+    inline Animation *current_animation() { return manager->components.current_animation[component_index]; }
+    inline int current_animation_frame() { return manager->components.animation_frame[component_index]; }
 
-    void update_current_animation(float dt);
+    void set_animation(Animation *animation); // Plays animation from the start, NULL for none.
 };
 
+void update_entity_animations(Entity_Manager *manager, float dt);
+
 enum Guy_State {
     GUY_STATE_IDLE,
     GUY_STATE_MOVING,
@@ -47,7 +60,6 @@ enum Guy_Orientation {
 struct Guy : public Entity {
     bool is_active = false;
     
-    Vector2 velocity;
     Vector2 max_velocity;
 
     Guy_State current_state = GUY_STATE_IDLE;
@@ -64,10 +76,10 @@ struct Guy : public Entity {
     Animation *looking_left_moving_animation;
 
     int light_source_id;
+    Entity_Handle light_source; // Resolved from light_source_id, see resolve_entity_references.
 
     void sync_geometry();
     
-    void set_animation(Animation *animation);
     void set_state(Guy_State state);
     void set_orientation(Guy_Orientation orientation);
     
@@ -76,7 +88,6 @@ struct Guy : public Entity {
 
 struct Tile {
     unsigned char id;
-    bool is_collidable;
 };
 
 struct Tilemap : public Entity {
@@ -88,9 +99,22 @@ struct Tilemap : public Entity {
     int width = 0;
     int height = 0;
     Tile *tiles = 0;
+
+    // One bit per tile, rows padded to whole words. See tilemap_collision.h.
+    u64 *collision_bits = 0;
+    int collision_words_per_row = 0;
+    u32 collision_generation = 0; // Different every time collision_bits get built, for anything built from them.
+
+    // Built when the tilemap gets drawn. See tilemap_mesh.h.
+    Tilemap_Chunk *chunks = 0;
+    int num_chunks_x = 0;
+    int num_chunks_y = 0;
+
+    // Built when a light near the tilemap gets drawn. See shadow_segments.h.
+    Tilemap_Shadow_Edges *shadow_edges = 0;
     
     int num_textures = 0;
-    Texture **textures = 0;
+    Texture_Region **textures = 0; // Owned by the Texture_Registry.
 };
 
 bool load_tilemap(Tilemap *tilemap, char *name);
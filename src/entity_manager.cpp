@@ -3,8 +3,77 @@
 #include "entities.h"
 #include "animation.h"
 #include "game.h"
+#include "camera.h"
 
 #include "animation_registry.h"
+#include "tilemap_mesh.h"
+#include "shadow_segments.h"
+
+template <typename T>
+static void add_to_type_array(Array <T *> *array, T *e) {
+    e->type_index = array->count;
+    array->add(e);
+}
+
+template <typename T>
+static void remove_from_type_array(Array <T *> *array, T *e) {
+    int index = e->type_index;
+    assert((*array)[index] == e);
+    
+    array->unordered_remove_by_index(index);
+    if (index < array->count) (*array)[index]->type_index = index;
+}
+
+int Entity_Components::add_row(Entity *e) {
+    int index = owner.count;
+    owner.add(e);
+    position.add(Vector2(0, 0));
+    previous_position.add(Vector2(0, 0));
+    size.add(Vector2(0, 0));
+    velocity.add(Vector2(0, 0));
+    current_animation.add(NULL);
+    animation_phase.add(0.0f);
+    animation_frame.add(0);
+    animation_rate.add(0.0f);
+    animation_num_frames.add(1);
+    animation_is_looping.add(0.0f);
+    return index;
+}
+
+void Entity_Components::copy_row(int dest, int source) {
+    position[dest] = position[source];
+    previous_position[dest] = previous_position[source];
+    size[dest] = size[source];
+    velocity[dest] = velocity[source];
+    current_animation[dest] = current_animation[source];
+    animation_phase[dest] = animation_phase[source];
+    animation_frame[dest] = animation_frame[source];
+    animation_rate[dest] = animation_rate[source];
+    animation_num_frames[dest] = animation_num_frames[source];
+    animation_is_looping[dest] = animation_is_looping[source];
+}
+
+void Entity_Components::remove_row(int index) {
+    // The last row is about to move into index. If it's an unsaved one moving in front of
+    // first_unsaved_row, save it now, since it won't be at the end anymore.
+    int last = owner.count - 1;
+    if ((index < first_unsaved_row) && (last >= first_unsaved_row)) previous_position[last] = position[last];
+
+    owner.unordered_remove_by_index(index);
+    position.unordered_remove_by_index(index);
+    previous_position.unordered_remove_by_index(index);
+    size.unordered_remove_by_index(index);
+    velocity.unordered_remove_by_index(index);
+    current_animation.unordered_remove_by_index(index);
+    animation_phase.unordered_remove_by_index(index);
+    animation_frame.unordered_remove_by_index(index);
+    animation_rate.unordered_remove_by_index(index);
+    animation_num_frames.unordered_remove_by_index(index);
+    animation_is_looping.unordered_remove_by_index(index);
+
+    if (index < owner.count) owner[index]->component_index = index;
+    first_unsaved_row = Min(first_unsaved_row, owner.count);
+}
 
 void Entity_Manager::register_entity(Entity *e, int id) {
     if (id == -1) {
@@ -16,8 +85,25 @@ void Entity_Manager::register_entity(Entity *e, int id) {
         e->id = id;
         next_entity_id = id + 1;
     }
+    e->all_entities_index = all_entities.count;
     all_entities.add(e);
     e->manager = this;
+    e->scheduled_for_destruction = false;
+    e->component_index = components.add_row(e);
+
+    int index = first_free_slot;
+    if (index != -1) {
+        first_free_slot = slots[index].next_free;
+    } else {
+        index = slots.count;
+        assert((u32)index <= ENTITY_HANDLE_INDEX_MASK);
+        slots.add(Entity_Slot());
+    }
+
+    Entity_Slot *slot = &slots[index];
+    slot->entity = e;
+    slot->next_free = -1;
+    e->handle.value = (slot->generation << ENTITY_HANDLE_INDEX_BITS) | (u32)index;
 }
 
 Entity *Entity_Manager::get_entity_by_id(int id) {
@@ -26,47 +112,194 @@ Entity *Entity_Manager::get_entity_by_id(int id) {
     return NULL;
 }
 
+Entity *Entity_Manager::get_entity(Entity_Handle handle) {
+    u32 index = handle.get_index();
+    if (index >= (u32)slots.count) return NULL;
+
+    Entity_Slot *slot = &slots[index];
+    if (slot->generation != handle.get_generation()) return NULL;
+    return slot->entity;
+}
+
+void Entity_Manager::destroy_entity(Entity *e) {
+    assert(e->manager == this);
+    if (e->scheduled_for_destruction) return;
+
+    e->scheduled_for_destruction = true;
+    entities_to_destroy.add(e);
+}
+
+void Entity_Manager::destroy_scheduled_entities() {
+    for (Entity *e : entities_to_destroy) destroy_entity_now(e);
+
+    num_destroyed_since_compaction += entities_to_destroy.count;
+    entities_to_destroy.clear();
+
+    if (num_destroyed_since_compaction >= ENTITY_MANAGER_COMPACTION_INTERVAL) {
+        compact();
+    }
+}
+
+void Entity_Manager::compact() {
+    num_destroyed_since_compaction = 0;
+
+    pools._Guy.release_empty_slabs();
+    pools._Enemy.release_empty_slabs();
+    pools._Thumbleweed.release_empty_slabs();
+    pools._Light_Source.release_empty_slabs();
+    pools._Tree.release_empty_slabs();
+
+    by_type._Guy.shrink();
+    by_type._Enemy.shrink();
+    by_type._Thumbleweed.shrink();
+    by_type._Light_Source.shrink();
+    by_type._Tree.shrink();
+    all_entities.shrink();
+    entities_to_destroy.shrink();
+
+    components.owner.shrink();
+    components.position.shrink();
+    components.previous_position.shrink();
+    components.size.shrink();
+    components.velocity.shrink();
+    components.current_animation.shrink();
+    components.animation_phase.shrink();
+    components.animation_frame.shrink();
+    components.animation_rate.shrink();
+    components.animation_num_frames.shrink();
+    components.animation_is_looping.shrink();
+
+    grid.remove_empty_cells();
+}
+
+void Entity_Manager::save_previous_positions() {
+    memcpy(components.previous_position.data, components.position.data, components.position.count * sizeof(Vector2));
+    if (camera) camera->previous_position = camera->position;
+    components.first_unsaved_row = components.owner.count;
+}
+
+void Entity_Manager::save_new_previous_positions() {
+    for (int i = components.first_unsaved_row; i < components.owner.count; i++) {
+        components.previous_position[i] = components.position[i];
+    }
+    components.first_unsaved_row = components.owner.count;
+}
+
+void Entity_Manager::update_spatial_grid() {
+    for (int i = 0; i < components.owner.count; i++) {
+        grid.update(components.owner[i], components.position[i], components.size[i]);
+    }
+}
+
+void Entity_Manager::destroy_entity_now(Entity *e) {
+    assert(get_entity(e->handle) == e);
+
+    Entity_Slot *slot = &slots[e->handle.get_index()];
+    slot->entity = NULL;
+    slot->generation = (slot->generation + 1) & ENTITY_HANDLE_GENERATION_MASK;
+    if (!slot->generation) slot->generation = 1;
+    slot->next_free = first_free_slot;
+    first_free_slot = (int)e->handle.get_index();
+
+    entity_lookup.remove(e->id);
+    grid.remove(e);
+    components.remove_row(e->component_index);
+
+    int index = e->all_entities_index;
+    all_entities.unordered_remove_by_index(index);
+    if (index < all_entities.count) all_entities[index]->all_entities_index = index;
+
+    switch (e->type) {
+        case ENTITY_TYPE_GUY: {
+            remove_from_type_array(&by_type._Guy, (Guy *)e);
+            pools._Guy.release((Guy *)e);
+        } break;
+
+        case ENTITY_TYPE_ENEMY: {
+            remove_from_type_array(&by_type._Enemy, (Enemy *)e);
+            pools._Enemy.release((Enemy *)e);
+        } break;
+
+        case ENTITY_TYPE_THUMBLEWEED: {
+            remove_from_type_array(&by_type._Thumbleweed, (Thumbleweed *)e);
+            pools._Thumbleweed.release((Thumbleweed *)e);
+        } break;
+
+        case ENTITY_TYPE_LIGHT_SOURCE: {
+            remove_from_type_array(&by_type._Light_Source, (Light_Source *)e);
+            pools._Light_Source.release((Light_Source *)e);
+        } break;
+
+        case ENTITY_TYPE_TREE: {
+            remove_from_type_array(&by_type._Tree, (Tree *)e);
+            pools._Tree.release((Tree *)e);
+        } break;
+
+        case ENTITY_TYPE_TILEMAP: {
+            if (tilemap == e) tilemap = NULL;
+            release_tilemap_chunks((Tilemap *)e);
+            release_tilemap_shadow_edges((Tilemap *)e);
+            delete (Tilemap *)e;
+        } break;
+    }
+}
+
 Entity *Entity_Manager::add_entity(Entity *source, int id) {
-    s64 size = 0;
     Entity *e = NULL;
     switch (source->type) {
         case ENTITY_TYPE_GUY: {
-            e = (Entity *)new Guy();
-            size = sizeof(Guy);
-            by_type._Guy.add((Guy *)e);
-        }
+            Guy *guy = pools._Guy.get();
+            *guy = *(Guy *)source;
+            add_to_type_array(&by_type._Guy, guy);
+            e = guy;
+        } break;
 
         case ENTITY_TYPE_ENEMY: {
-            e = (Entity *)new Enemy();
-            size = sizeof(Enemy);
-            by_type._Enemy.add((Enemy *)e);
-        }
+            Enemy *enemy = pools._Enemy.get();
+            *enemy = *(Enemy *)source;
+            add_to_type_array(&by_type._Enemy, enemy);
+            e = enemy;
+        } break;
 
         case ENTITY_TYPE_THUMBLEWEED: {
-            e = (Entity *)new Thumbleweed();
-            size = sizeof(Thumbleweed);
-            by_type._Thumbleweed.add((Thumbleweed *)e);
-        }
+            Thumbleweed *thumbleweed = pools._Thumbleweed.get();
+            *thumbleweed = *(Thumbleweed *)source;
+            add_to_type_array(&by_type._Thumbleweed, thumbleweed);
+            e = thumbleweed;
+        } break;
+
+        case ENTITY_TYPE_LIGHT_SOURCE: {
+            Light_Source *light_source = pools._Light_Source.get();
+            *light_source = *(Light_Source *)source;
+            add_to_type_array(&by_type._Light_Source, light_source);
+            e = light_source;
+        } break;
 
         case ENTITY_TYPE_TREE: {
-            e = (Entity *)new Tree();
-            size = sizeof(Tree);
-            by_type._Tree.add((Tree *)e);
+            Tree *tree = pools._Tree.get();
+            *tree = *(Tree *)source;
+            add_to_type_array(&by_type._Tree, tree);
+            e = tree;
+        } break;
+
+        default: {
+            log_error("Entities of type %d can't be copied.\n", source->type);
+            return NULL;
         }
     }
 
-    memcpy(e, source, size);
     register_entity(e, id);
+    components.copy_row(e->component_index, source->component_index);
     return e;
 }
 
 Guy *Entity_Manager::make_guy(int id) {
-    Guy *guy = new Guy();
-    by_type._Guy.add(guy);
+    Guy *guy = pools._Guy.get();
+    add_to_type_array(&by_type._Guy, guy);
     register_entity(guy, id);
     guy->type = ENTITY_TYPE_GUY;
 
-    guy->size = Vector2(1, 1);
+    guy->size() = Vector2(1, 1);
     
     guy->looking_down_idle_animation = globals.animation_registry->get("player_looking_down_idle");
     guy->looking_right_idle_animation = globals.animation_registry->get("player_looking_right_idle");
@@ -78,32 +311,32 @@ Guy *Entity_Manager::make_guy(int id) {
     guy->looking_up_moving_animation = globals.animation_registry->get("player_looking_up_moving");
     guy->looking_left_moving_animation = globals.animation_registry->get("player_looking_left_moving");
 
-    guy->current_animation = guy->looking_down_idle_animation;
+    guy->set_animation(guy->looking_down_idle_animation);
 
     return guy;
 }
 
 Thumbleweed *Entity_Manager::make_thumbleweed(int id) {
-    Thumbleweed *thumbleweed = new Thumbleweed();
-    by_type._Thumbleweed.add(thumbleweed);
+    Thumbleweed *thumbleweed = pools._Thumbleweed.get();
+    add_to_type_array(&by_type._Thumbleweed, thumbleweed);
     register_entity(thumbleweed, id);
     thumbleweed->type = ENTITY_TYPE_THUMBLEWEED;
 
-    thumbleweed->size = Vector2(1, 1);
+    thumbleweed->size() = Vector2(1, 1);
 
     thumbleweed->idle_animation = globals.animation_registry->get("thumbleweed_idle");
     thumbleweed->moving_animation = globals.animation_registry->get("thumbleweed_moving");
     thumbleweed->attack_animation = globals.animation_registry->get("thumbleweed_attack");
     thumbleweed->transformation_animation = globals.animation_registry->get("thumbleweed_transformation");
 
-    thumbleweed->current_animation = thumbleweed->idle_animation;
+    thumbleweed->set_animation(thumbleweed->idle_animation);
 
     return thumbleweed;
 }
 
 Light_Source *Entity_Manager::make_light_source(int id) {
-    Light_Source *source = new Light_Source();
-    by_type._Light_Source.add(source);
+    Light_Source *source = pools._Light_Source.get();
+    add_to_type_array(&by_type._Light_Source, source);
     register_entity(source, id);
     source->type = ENTITY_TYPE_LIGHT_SOURCE;
 
@@ -121,26 +354,26 @@ Tilemap *Entity_Manager::make_tilemap(int id) {
 }
 
 Tree *Entity_Manager::make_tree(int id) {
-    Tree *tree = new Tree();
-    by_type._Tree.add(tree);
+    Tree *tree = pools._Tree.get();
+    add_to_type_array(&by_type._Tree, tree);
     register_entity(tree, id);
     tree->type = ENTITY_TYPE_TREE;
 
-    tree->size.y = 3.0f;
-    tree->size.x = tree->size.y * 0.833333f;
+    tree->size().y = 3.0f;
+    tree->size().x = tree->size().y * 0.833333f;
     
-    tree->current_animation = globals.animation_registry->get("tree");
+    tree->set_animation(globals.animation_registry->get("tree"));
     
     return tree;
 }
 
 Enemy *Entity_Manager::make_enemy(int id) {
-    Enemy *enemy = new Enemy();
-    by_type._Enemy.add(enemy);
+    Enemy *enemy = pools._Enemy.get();
+    add_to_type_array(&by_type._Enemy, enemy);
     register_entity(enemy, id);
     enemy->type = ENTITY_TYPE_ENEMY;
     
-    enemy->size = Vector2(2, 2);
+    enemy->size() = Vector2(2, 2);
     
     return enemy;
 }
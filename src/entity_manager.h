@@ -2,6 +2,9 @@
 
 #include "array.h"
 #include "hash_table.h"
+#include "pool.h"
+#include "geometry.h"
+#include "spatial_grid.h"
 
 struct Entity;
 struct Guy;
@@ -12,6 +15,67 @@ struct Light_Source;
 struct Tree;
 
 struct Camera;
+struct Animation;
+
+//
+// A handle is a slot index in the manager's slot table plus the generation the slot had when
+// the handle was made. Destroying an entity bumps the generation of its slot, so handles to it
+// go stale instead of pointing at whatever reuses the slot. 0 is never a valid handle.
+//
+// Handles are only valid while the program runs, savegames keep using entity ids.
+//
+
+const int ENTITY_HANDLE_INDEX_BITS = 20;
+const u32 ENTITY_HANDLE_INDEX_MASK = (1u << ENTITY_HANDLE_INDEX_BITS) - 1;
+const u32 ENTITY_HANDLE_GENERATION_MASK = (1u << (32 - ENTITY_HANDLE_INDEX_BITS)) - 1;
+
+struct Entity_Handle {
+    u32 value = 0;
+
+    inline u32 get_index() { return value & ENTITY_HANDLE_INDEX_MASK; }
+    inline u32 get_generation() { return value >> ENTITY_HANDLE_INDEX_BITS; }
+};
+
+inline bool operator==(Entity_Handle a, Entity_Handle b) { return a.value == b.value; }
+inline bool operator!=(Entity_Handle a, Entity_Handle b) { return a.value != b.value; }
+
+struct Entity_Slot {
+    Entity *entity = NULL;
+    u32 generation = 1;
+    int next_free = -1;
+};
+
+//
+// Fields that the per-tick loops touch, pulled out of the entities into one row per entity so
+// that those loops walk plain arrays instead of whole objects. Rows are kept dense: removing
+// one moves the last row into its place and fixes up the moved entity's component_index.
+//
+
+struct Entity_Components {
+    Array <Entity *> owner;
+    Array <Vector2> position;
+    Array <Vector2> previous_position; // Position before the last tick, for drawing between ticks.
+    Array <Vector2> size;
+    Array <Vector2> velocity;
+
+    // Animation playback, see update_entity_animations. The clip's frame rate, frame count and
+    // looping flag get copied next to the playback state so that the update doesn't have to
+    // look at the (shared) clip at all.
+    Array <Animation *> current_animation;
+    Array <float> animation_phase; // Frames played so far, fractional.
+    Array <int> animation_frame;
+    Array <float> animation_rate;
+    Array <int> animation_num_frames;
+    Array <float> animation_is_looping; // 1 or 0, a float so that the update can blend with it.
+
+    // Rows from here on got added since the last save_previous_positions, so their
+    // previous_position isn't anything yet. remove_row keeps them at the end.
+    int first_unsaved_row = 0;
+
+    int add_row(Entity *e);
+    void copy_row(int dest, int source);
+    void remove_row(int index);
+};
 
 struct Entities_By_Type {
     Array <Guy *> _Guy;
@@ -21,17 +85,56 @@ struct Entities_By_Type {
     Array <Tree *> _Tree;
 };
 
+struct Entity_Pools {
+    Pool <Guy> _Guy;
+    Pool <Enemy> _Enemy;
+    Pool <Thumbleweed> _Thumbleweed;
+    Pool <Light_Source> _Light_Source;
+    Pool <Tree> _Tree;
+};
+
+// destroy_scheduled_entities compacts the manager after this many entities got destroyed.
+const int ENTITY_MANAGER_COMPACTION_INTERVAL = 4096;
+
 struct Entity_Manager {
     Entities_By_Type by_type;
+    Entity_Pools pools;
+    Entity_Components components;
+    Spatial_Grid grid; // Synced once per tick by update_spatial_grid.
     Hash_Table <int, Entity *> entity_lookup;
     Array <Entity *> all_entities;
     int next_entity_id = 0;
 
+    Array <Entity_Slot> slots;
+    int first_free_slot = -1;
+
+    u32 animation_clip_generation = 0; // The global one at the time the animation columns were synced.
+
+    Array <Entity *> entities_to_destroy;
+    int num_destroyed_since_compaction = 0;
+
     Camera *camera = NULL;
     Tilemap *tilemap = NULL;
 
     Entity *get_entity_by_id(int id);
+    Entity *get_entity(Entity_Handle handle); // NULL if the entity was destroyed.
     Entity *add_entity(Entity *e, int id = -1);
+
+    // Entities stay alive until destroy_scheduled_entities runs at the end of the tick, so
+    // the per-type arrays can be iterated while destroying.
+    void destroy_entity(Entity *e);
+    void destroy_scheduled_entities();
+    void compact(); // Gives back empty pool slabs and unused array capacity.
+
+    void update_spatial_grid();
+
+    // Called before every tick, and every frame while the game isn't ticking so that things
+    // moved by the editor don't get drawn where they used to be.
+    void save_previous_positions();
+
+    // Called before drawing: entities made since the last tick get drawn where they were put,
+    // instead of sliding in from the origin.
+    void save_new_previous_positions();
     
     Guy *make_guy(int id = -1);
     Tilemap *make_tilemap(int id = -1);
@@ -46,4 +149,5 @@ struct Entity_Manager {
     
 private:
     void register_entity(Entity *e, int id = -1);
+    void destroy_entity_now(Entity *e);
 };
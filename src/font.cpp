@@ -87,7 +87,8 @@ Glyph_Data *Dynamic_Font::get_or_load_glyph(int utf32) {
         return NULL;
     }
     
-    Glyph_Data *data = (Glyph_Data *)glyph_and_page_arena.get(sizeof(*data));
+    Glyph_Data *data = (Glyph_Data *)glyph_and_page_arena.get(sizeof(*data), alignof(Glyph_Data));
+    *data = {};
     glyph_lookup.add(utf32, data);
     
     data->advance = face->glyph->advance.x >> 6;
@@ -108,9 +109,8 @@ Glyph_Data *Dynamic_Font::get_or_load_glyph(int utf32) {
 }
 
 static Font_Page *add_font_page(Dynamic_Font *font) {
-    Font_Page *page = (Font_Page *)glyph_and_page_arena.get(sizeof(*page));
-    page->cursor_x = 0;
-    page->cursor_y = 0;
+    Font_Page *page = (Font_Page *)glyph_and_page_arena.get(sizeof(*page), alignof(Font_Page));
+    *page = {};
 
     Bitmap bitmap = {};
     bitmap.width = globals.font_page_size_x;
@@ -39,6 +39,12 @@ struct Time_Info {
 
     float real_world_time = 0.0f;
     float real_world_dt = 0.0f;
+
+    // Fixed-step telemetry. When a frame would need more than max_ticks_per_frame ticks to catch
+    // up, the rest of the time is dropped and the game runs slower than real time instead.
+    int ticks_this_frame = 0;
+    s64 num_frames_over_budget = 0;
+    double dropped_time = 0.0;
 };
 
 enum Program_Mode {
@@ -47,16 +53,14 @@ enum Program_Mode {
     PROGRAM_MODE_EDITOR,
 };
 
-enum Render_Type {
-    RENDER_TYPE_LIGHTS,
-    RENDER_TYPE_MAIN,
-};
-
 struct Game_Globals {
     double last_time = 0.0;
     double time_rate = 1.0;
     Time_Info time_info;
 
+    int max_ticks_per_frame = 5;
+    float render_alpha = 1.0f; // How far between the previous and the current tick to draw.
+
     Game_Mode_Info *current_game_mode;
     
     bool should_quit_game = false;
@@ -93,7 +97,6 @@ struct Game_Globals {
     int font_page_size_y = 0;
 
     Program_Mode program_mode = PROGRAM_MODE_GAME;
-    Render_Type render_type = RENDER_TYPE_MAIN;
     
     int mouse_x_offset = 0;
     int mouse_y_offset = 0;
@@ -120,10 +123,25 @@ struct Key_Info {
     bool changed;
 };
 
+// Called once per frame before the new key states come in.
+void begin_key_frame();
+void set_key_state(int key_code, bool is_down);
+
 bool is_key_down(int key_code);
 bool is_key_pressed(int key_code);
 bool was_key_just_released(int key_code);
 
+void init_shaders();
+void init_game();
+
+const double GAMEPLAY_DT = 1.0 / 60.0; // @Hardcode
+
+void simulate_game(); // One GAMEPLAY_DT tick.
+
+// Runs the ticks that frame_dt of real time makes due, but no more than max_ticks_per_frame
+// of them. Sets render_alpha and the fixed-step telemetry in time_info.
+void simulate_pending_ticks(double frame_dt);
+
 Game_Mode_Info *load_game_mode(Game_Mode game_mode);
 
 Entity_Manager *get_entity_manager();
@@ -7,56 +7,198 @@
 #include <string.h>
 #include <ctype.h>
 
-struct Temporary_Storage {
-    s64 size = 0;
-    s64 occupied = 0;
-    u8 *data = 0;
-};
+static Memory_Arena_Block *make_memory_arena_block(Memory_Arena *arena, s64 size) {
+    Memory_Arena_Block *block = new Memory_Arena_Block();
+    block->size = size;
+    block->data = (u8 *)malloc(size);
+    arena->num_blocks += 1;
+    arena->reserved += size;
+    return block;
+}
+
+void Memory_Arena::init(s64 _block_size) {
+    block_size = _block_size;
+    if (!first) {
+        first = make_memory_arena_block(this, block_size);
+        current = first;
+    }
+}
 
-static Temporary_Storage temporary_storage;
+void Memory_Arena::set_mark(s64 mark) {
+    assert(mark >= 0 && mark <= occupied);
+    if (!first) return;
 
-void init_temporary_storage(s64 size) {
-    temporary_storage.size = size;
-    temporary_storage.occupied = 0;
-    temporary_storage.data = (u8 *)malloc(size);
-    memset(temporary_storage.data, 0, size);
+    // A mark right at the end of a block that was left belongs to the next block, so that the
+    // tail skipped when leaving it still counts as wasted. current's tail_wasted is stale until
+    // current gets left, so the walk never goes past it.
+    wasted = 0;
+    Memory_Arena_Block *block = first;
+    while ((block != current) && (mark >= block->base + block->size)) {
+        wasted += block->tail_wasted;
+        block = block->next;
+    }
+
+    current = block;
+    occupied = mark;
 }
 
-void reset_temporary_storage() {
-    temporary_storage.occupied = 0;
+void Memory_Arena::reset() {
+    occupied = 0;
+    wasted = 0;
+    current = first;
 }
 
-s64 get_temporary_storage_mark() {
-    return temporary_storage.occupied;
+void Memory_Arena::decommit_unused_blocks() {
+    if (!current) return;
+
+    Memory_Arena_Block *block = current->next;
+    while (block) {
+        Memory_Arena_Block *next = block->next;
+        num_blocks -= 1;
+        reserved -= block->size;
+        free(block->data);
+        delete block;
+        block = next;
+    }
+    current->next = NULL;
 }
 
-void set_temporary_storage_mark(s64 mark) {
-    temporary_storage.occupied = mark;
+void Memory_Arena::release() {
+    current = first;
+    decommit_unused_blocks();
+
+    if (first) {
+        free(first->data);
+        delete first;
+    }
+
+    first = NULL;
+    current = NULL;
+    num_blocks = 0;
+    occupied = 0;
+    wasted = 0;
+    reserved = 0;
 }
 
-void *talloc(s64 size, s64 alignment) {
-    while (temporary_storage.occupied + size > temporary_storage.size) {
-        u8 *new_data = (u8 *)malloc(temporary_storage.size * 2);
-        memcpy(new_data, temporary_storage.data, temporary_storage.size);
-        memset(new_data + size, 0, temporary_storage.size);
-        free(temporary_storage.data);
-        temporary_storage.data = new_data;
-        temporary_storage.size *= 2;
+// Makes the block after current one that can hold at least size bytes.
+static Memory_Arena_Block *advance_memory_arena_block(Memory_Arena *arena, s64 size) {
+    Memory_Arena_Block *current = arena->current;
+    Memory_Arena_Block *next = current->next;
+
+    current->tail_wasted = current->base + current->size - arena->occupied;
+    arena->wasted += current->tail_wasted;
+
+    if (!next || next->size < size) {
+        Memory_Arena_Block *block = make_memory_arena_block(arena, Max(arena->block_size, size));
+        block->next = next;
+        current->next = block;
+        next = block;
+
+        // Everything after current is unused, so the following blocks can be rebased freely.
+        for (Memory_Arena_Block *b = current; b->next; b = b->next) {
+            b->next->base = b->base + b->size;
+        }
     }
 
-    s64 alignment_offset = 0;
+    arena->current = next;
+    arena->occupied = next->base;
+    return next;
+}
+
+void *Memory_Arena::get(s64 size, s64 alignment) {
+    if (!first) init(block_size ? block_size : MEMORY_ARENA_DEFAULT_BLOCK_SIZE);
 
-    s64 result_pointer = (s64)temporary_storage.data + temporary_storage.occupied;
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
     s64 alignment_mask = alignment - 1;
-    if (result_pointer & alignment_mask) {
-        alignment_offset = alignment - (result_pointer & alignment_mask);
+
+    Memory_Arena_Block *block = current;
+    
+    s64 offset = occupied - block->base;
+    s64 alignment_offset = (s64)(-(intptr_t)(block->data + offset) & alignment_mask);
+    if (offset + alignment_offset + size > block->size) {
+        block = advance_memory_arena_block(this, size + alignment_mask);
+        offset = 0;
+        alignment_offset = (s64)(-(intptr_t)block->data & alignment_mask);
     }
+
+    void *result = (void *)(block->data + offset + alignment_offset);
+    occupied = block->base + offset + alignment_offset + size;
+
+    if (occupied > high_water_mark) high_water_mark = occupied;
     
-    void *result = (void *)(temporary_storage.data + temporary_storage.occupied);
-    temporary_storage.occupied += size + alignment_offset;
     return result;
 }
 
+//
+// Every thread has its own frame storage and its own pair of scratch arenas, so none of
+// this needs locking. Only the main thread calls reset_temporary_storage; other threads
+// must wrap their work in a Temporary_Storage_Scope or a Temp_Scope.
+//
+
+const int NUM_SCRATCH_ARENAS = 2;
+
+static s64 temporary_storage_block_size = MEMORY_ARENA_DEFAULT_BLOCK_SIZE;
+static thread_local Memory_Arena temporary_storage;
+static thread_local Memory_Arena scratch_arenas[NUM_SCRATCH_ARENAS];
+
+static thread_local int temporary_storage_blocks_reported = 1;
+static thread_local s64 last_frame_high_water_mark = 0;
+
+// Sets the block size for the calling thread right away and for every thread that
+// touches temporary storage for the first time afterwards.
+void init_temporary_storage(s64 size) {
+    temporary_storage_block_size = size;
+    temporary_storage.init(size);
+}
+
+void reset_temporary_storage() {
+    auto ts = &temporary_storage;
+
+    last_frame_high_water_mark = ts->high_water_mark;
+    ts->high_water_mark = 0;
+    ts->reset();
+
+    if (ts->num_blocks > temporary_storage_blocks_reported) {
+        temporary_storage_blocks_reported = ts->num_blocks;
+        log("Temporary storage needed %lld bytes in one frame, which took %d blocks of %lld bytes. Consider raising the size passed to init_temporary_storage.\n",
+            last_frame_high_water_mark, ts->num_blocks, ts->block_size);
+    }
+}
+
+Memory_Arena *get_temporary_storage() {
+    if (!temporary_storage.block_size) temporary_storage.block_size = temporary_storage_block_size;
+    return &temporary_storage;
+}
+
+Memory_Arena *get_scratch(Memory_Arena *conflict) {
+    for (int i = 0; i < NUM_SCRATCH_ARENAS; i++) {
+        Memory_Arena *scratch = &scratch_arenas[i];
+        if (scratch != conflict) {
+            if (!scratch->block_size) scratch->block_size = temporary_storage_block_size;
+            return scratch;
+        }
+    }
+
+    assert(!"Unreachable");
+    return NULL;
+}
+
+s64 get_temporary_storage_mark() {
+    return temporary_storage.get_mark();
+}
+
+void set_temporary_storage_mark(s64 mark) {
+    temporary_storage.set_mark(mark);
+}
+
+s64 get_temporary_storage_high_water_mark() {
+    return last_frame_high_water_mark;
+}
+
+void *talloc(s64 size, s64 alignment) {
+    return get_temporary_storage()->get(size, alignment);
+}
+
 char *sprint(char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
@@ -70,7 +212,8 @@ char *sprint(char *fmt, ...) {
 }
 
 char *sprint_valist(char *fmt, va_list args) {
-    va_list ap = args;
+    va_list ap;
+    va_copy(ap, args);
     size_t n = 1 + vsnprintf(NULL, 0, fmt, ap);
     va_end(ap);
     char *str = (char *)malloc(n);
@@ -92,7 +235,8 @@ char *tprint(char *fmt, ...) {
 }
 
 char *tprint_valist(char *fmt, va_list args) {
-    va_list ap = args;
+    va_list ap;
+    va_copy(ap, args);
     size_t n = 1 + vsnprintf(NULL, 0, fmt, ap);
     va_end(ap);
     char *str = (char *)talloc(n);
@@ -293,6 +437,23 @@ char *concatenate(char *a, char *b) {
     return result;
 }
 
+char *read_entire_text_file(char *filepath) {
+    char *result = NULL;
+
+    FILE *file = fopen(filepath, "rt");
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        size_t length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        result = new char[length + 1];
+        size_t num_read = fread(result, 1, length, file);
+        result[num_read] = 0;
+        fclose(file);
+    }
+    return result;
+}
+
 s64 string_length(char *s) {
     if (!s) return 0;
 
@@ -304,8 +465,7 @@ s64 string_length(char *s) {
 }
 
 void log(char *string, ...) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     va_list args;
     va_start(args, string);
@@ -316,8 +476,7 @@ void log(char *string, ...) {
 }
 
 void log_error(char *string, ...) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     va_list args;
     va_start(args, string);
@@ -330,8 +489,7 @@ void log_error(char *string, ...) {
 }
 
 void print(char *string, ...) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     va_list args;
     va_start(args, string);
@@ -404,6 +562,20 @@ char *copy_strip_extension(char *filename, bool use_temporary_storage) {
     return result;
 }
 
+char *get_asset_name_from_path(char *path, char *directory) {
+    if (!starts_with(path, directory)) return NULL;
+
+    char *name = path + string_length(directory);
+    if (name[0] != '/') return NULL;
+    name += 1;
+
+    char *slash = strrchr(name, '/');
+    char *dot = strrchr(name, '.');
+    if (!dot || (slash && dot < slash)) return NULL;
+
+    return copy_strip_extension(name, true);
+}
+
 char *concatenate_with_newlines(char **array, s64 array_count, bool use_temporary_storage) {
     s64 dest_string_length = 1;
     for (s64 i = 0; i < array_count; i++) {
@@ -430,35 +602,6 @@ char *concatenate_with_newlines(char **array, s64 array_count, bool use_temporar
     return dest;
 }
 
-void Memory_Arena::init(s64 _size) {
-    occupied = 0;
-    size = _size;
-    data = (u8 *)malloc(size);
-}
-
-void *Memory_Arena::get(s64 _size) {
-    if (occupied + _size > size) {
-        s64 old_size = size;
-        s64 new_size = Max(size * 2, size + _size);
-
-        u8 *new_data = (u8 *)malloc(new_size);
-        if (data) {
-            memcpy(new_data, data, old_size);
-            memset(new_data + old_size, 0, new_size - old_size);
-            free(data);
-        } else {
-            memset(new_data, 0, new_size);
-        }
-
-        data = new_data;
-        size = new_size;
-    }
-
-    void *result = (void *)(data + occupied);
-    occupied += _size;
-    return result;
-}
-
 // From https://www.geeksforgeeks.org/rounding-floating-point-number-two-decimal-places-c-c/
 float round_to_two_decimal_places(float var) {
     // 37.66666 * 100 =3766.66
@@ -59,20 +59,101 @@ inline T Clamp(T x, T a, T b) {
 const float PI = 3.14159265359f;
 const float TAU = 6.28318530718f;
 
-struct Memory_Arena {
-    s64 occupied = 0;
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit. mask must not be zero.
+inline int lowest_set_bit_index(u32 mask) {
+    assert(mask);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//
+// A chain of blocks that are never moved, so pointers into an arena stay valid until it
+// gets reset or released. Every block knows its logical base offset, which lets a mark be
+// a single s64 that is valid across blocks.
+//
+
+struct Memory_Arena_Block {
+    Memory_Arena_Block *next = nullptr;
+    s64 base = 0;
     s64 size = 0;
-    u8 *data = 0;
+    s64 tail_wasted = 0; // Bytes skipped at the end when the block was left for the next one.
+    u8 *data = nullptr;
+};
 
-    void init(s64 size);
-    void *get(s64 size);
+const s64 MEMORY_ARENA_DEFAULT_BLOCK_SIZE = Kilobytes(64);
+
+struct Memory_Arena {
+    s64 block_size = 0; // 0 means MEMORY_ARENA_DEFAULT_BLOCK_SIZE.
+    
+    Memory_Arena_Block *first = nullptr;
+    Memory_Arena_Block *current = nullptr;
+    int num_blocks = 0;
+
+    s64 occupied = 0; // Logical offset, see above.
+    s64 wasted = 0;   // Sum of tail_wasted of the blocks before current.
+    s64 reserved = 0;
+    s64 high_water_mark = 0;
+
+    Memory_Arena() {}
+    Memory_Arena(const Memory_Arena &) = delete;
+    Memory_Arena &operator=(const Memory_Arena &) = delete;
+    ~Memory_Arena() { release(); }
+
+    void init(s64 block_size);
+    void *get(s64 size, s64 alignment = 8);
+
+    s64 get_mark() { return occupied; }
+    void set_mark(s64 mark);
+    
+    void reset();   // Frees everything allocated but keeps the blocks.
+    void release(); // Gives all the blocks back.
+    void decommit_unused_blocks(); // Gives back the blocks after the current one.
+
+    s64 bytes_used() { return occupied - wasted; } // Includes alignment padding.
+    s64 bytes_wasted() { return wasted; }
+    s64 bytes_reserved() { return reserved; }
 };
 
 void init_temporary_storage(s64 size);
 void reset_temporary_storage();
 s64 get_temporary_storage_mark();
 void set_temporary_storage_mark(s64 mark);
-void *talloc(s64 mark, s64 alignment = 8);
+s64 get_temporary_storage_high_water_mark(); // Peak usage during the last frame.
+void *talloc(s64 size, s64 alignment = 8);
+
+// Temporary storage and scratch arenas are per thread, see general.cpp.
+
+Memory_Arena *get_temporary_storage(); // The calling thread's frame storage, what talloc uses.
+
+// Returns one of the calling thread's scratch arenas that is not conflict. A function that
+// gets handed an arena to allocate its results in passes it as conflict, so that freeing its
+// own scratch memory can't free the results of whoever called it.
+Memory_Arena *get_scratch(Memory_Arena *conflict = nullptr);
+
+// Restores the mark of arena at the end of the scope. Scopes can nest.
+struct Temp_Scope {
+    Memory_Arena *arena;
+    s64 mark;
+
+    Temp_Scope(Memory_Arena *_arena) { arena = _arena; mark = arena->get_mark(); }
+    ~Temp_Scope() { arena->set_mark(mark); }
+
+    void *alloc(s64 size, s64 alignment = 8) { return arena->get(size, alignment); }
+};
+
+// Temp_Scope on the calling thread's frame storage.
+struct Temporary_Storage_Scope : public Temp_Scope {
+    Temporary_Storage_Scope() : Temp_Scope(get_temporary_storage()) {}
+};
 
 char *sprint(char *fmt, ...);
 char *sprint_valist(char *fmt, va_list args);
@@ -94,6 +175,8 @@ char *concatenate_with_newlines(char **array, s64 array_count, bool use_temporar
 char *concatenate_with_commas(char **array, s64 array_count, bool use_temporary_storage = false);
 char *concatenate(char *a, char *b);
 
+char *read_entire_text_file(char *filepath);
+
 void log(char *string, ...);
 void log_error(char *string, ...);
 void print(char *string, ...);
@@ -108,4 +191,7 @@ char *replace_forwardslash_with_backslash(char *string);
 char *lowercase(char *string);
 char *copy_strip_extension(char *filename, bool use_temporary_storage = false);
 
+// "data/textures/tree.png" in "data/textures" is "tree". NULL if path isn't in directory. The result is in temporary storage.
+char *get_asset_name_from_path(char *path, char *directory);
+
 float round_to_two_decimal_places(float var);
@@ -129,6 +129,10 @@ inline Vector2 get_vec2(float theta) {
     return Vector2(ct, st);
 }
 
+inline Vector2 lerp(Vector2 a, Vector2 b, float t) {
+    return a + t * (b - a);
+}
+
 inline Vector2 absolute_value(Vector2 v) {
     Vector2 result;
 
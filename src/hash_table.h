@@ -6,28 +6,89 @@
 
 #include "general.h"
 
-inline int hash(int x) {
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = (x >> 16) ^ x;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASH_TABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+// splitmix64 finalizer.
+inline u64 hash(u64 x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
     return x;
 }
 
-inline int hash(char *str) {
-    int hash = 5381;
+inline u64 hash(int x) {
+    return hash((u64)(u32)x);
+}
+
+inline u64 hash(char *str) {
+    // FNV-1a, then mixed so that both the group index and the 7 control bits are usable.
+    u64 h = 0xcbf29ce484222325ULL;
+    for (char *at = str; *at; at++) {
+        h ^= (u8)*at;
+        h *= 0x100000001b3ULL;
+    }
+    return hash(h);
+}
+
+inline u64 hash(void *p) {
+    return hash((u64)(uintptr_t)p);
+}
+
+template <typename Key>
+inline bool hash_keys_match(Key a, Key b) {
+    return a == b;
+}
+
+inline bool hash_keys_match(char *a, char *b) {
+    return strings_match(a, b);
+}
+
+//
+// Open addressing with control bytes, laid out in groups of HASH_TABLE_GROUP_WIDTH slots.
+// Every slot has one control byte which is either HASH_TABLE_EMPTY or the low 7 bits of
+// the key's hash, so a whole group can be matched against a key with one SSE2 compare.
+//
+// Probing is linear over groups, starting at the key's home group. An entry always sits in
+// the first group (counting from its home) that was not full when it got inserted, which
+// lets remove() backward-shift later entries into the hole instead of leaving tombstones.
+//
 
-    int len = (int)string_length(str);
-    for (int i = 0; i < len; i++) {
-        hash = ((hash << 5) + hash) + str[i];
+const int HASH_TABLE_GROUP_WIDTH = 16;
+const int HASH_TABLE_INITIAL_CAPACITY = 256; // Must be a power of two and a multiple of HASH_TABLE_GROUP_WIDTH.
+const u8  HASH_TABLE_EMPTY = 0x80;
+
+// Bit i is set if control byte i of the group equals h2.
+inline u32 hash_group_match(u8 *group, u8 h2) {
+#ifdef HASH_TABLE_SSE2
+    __m128i ctrl = _mm_loadu_si128((__m128i *)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+    u32 mask = 0;
+    for (int i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        if (group[i] == h2) mask |= 1u << i;
     }
-    return hash;
+    return mask;
+#endif
 }
 
-#pragma warning(push, 0)
-inline int hash(void *p) {
-    return (int)p;
+// Bit i is set if slot i of the group is empty.
+inline u32 hash_group_match_empty(u8 *group) {
+#ifdef HASH_TABLE_SSE2
+    // Only HASH_TABLE_EMPTY has the high bit set.
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i *)group));
+#else
+    u32 mask = 0;
+    for (int i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        if (group[i] == HASH_TABLE_EMPTY) mask |= 1u << i;
+    }
+    return mask;
+#endif
 }
-#pragma warning(pop)
 
 template <typename Key, typename Value>
 struct Hash_Table {
@@ -36,146 +97,213 @@ struct Hash_Table {
         Value value;
     };
 
+    u8 *control = nullptr;
     Bucket *buckets = nullptr;
-    bool *occupancy_mask = nullptr;
     int allocated = 0;
     int count = 0;
 
+    inline int group_mask() {
+        return allocated / HASH_TABLE_GROUP_WIDTH - 1;
+    }
+
+    inline int home_group(u64 h) {
+        return (int)((h >> 7) & (u64)group_mask());
+    }
+
     inline void grow() {
-        const int HASH_TABLE_INITIAL_CAPACITY = 256;
-
-        if (!buckets) {
-            assert(allocated == 0);
-            assert(count == 0);
-            
-            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
-            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
-            allocated = HASH_TABLE_INITIAL_CAPACITY;
-            count = 0;
-        } else {
-            Hash_Table <Key, Value> new_hash_table = {
-                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
-                (bool *)calloc(allocated * 2, sizeof(bool)),
-                allocated * 2,
-                0,
-            };
-
-            memset(new_hash_table.buckets, 0, allocated * 2 * sizeof(Bucket));
-            memset(new_hash_table.occupancy_mask, 0, allocated * 2 * sizeof(bool));
-
-            for (int i = 0; i < count; i++) {
-                if (occupancy_mask[i]) {
-                    new_hash_table.add(buckets[i].key, buckets[i].value);
-                }
-            }
+        u8 *old_control = control;
+        Bucket *old_buckets = buckets;
+        int old_allocated = allocated;
 
-            free(buckets);
-            free(occupancy_mask);
+        allocated = old_allocated ? old_allocated * 2 : HASH_TABLE_INITIAL_CAPACITY;
+        control = (u8 *)malloc(allocated);
+        buckets = (Bucket *)malloc(allocated * sizeof(Bucket));
+        memset(control, HASH_TABLE_EMPTY, allocated);
+        count = 0;
 
-            *this = new_hash_table;
+        for (int i = 0; i < old_allocated; i++) {
+            if (old_control[i] == HASH_TABLE_EMPTY) continue;
+            Bucket *old = &old_buckets[i];
+            Bucket *bucket = insert_new(old->key, hash(old->key));
+            bucket->value = old->value;
         }
+
+        free(old_control);
+        free(old_buckets);
     }
 
-    inline void add(Key key, Value value) {
-        if (count >= allocated) {
-            grow();
+    // Assumes the key is not in the table and there is room for it.
+    inline Bucket *insert_new(Key key, u64 h) {
+        int mask = group_mask();
+        int g = home_group(h);
+        while (true) {
+            u32 empty = hash_group_match_empty(control + g * HASH_TABLE_GROUP_WIDTH);
+            if (empty) {
+                int slot = g * HASH_TABLE_GROUP_WIDTH + lowest_set_bit_index(empty);
+                control[slot] = (u8)(h & 0x7f);
+                buckets[slot].key = key;
+                count++;
+                return &buckets[slot];
+            }
+            g = (g + 1) & mask;
         }
+    }
+
+    inline Bucket *find_bucket(Key key, u64 h) {
+        if (!count) return nullptr;
+
+        u8 h2 = (u8)(h & 0x7f);
+        int mask = group_mask();
+        int g = home_group(h);
+        for (int probe = 0; probe <= mask; probe++) {
+            u8 *group = control + g * HASH_TABLE_GROUP_WIDTH;
+
+            u32 match = hash_group_match(group, h2);
+            while (match) {
+                Bucket *bucket = &buckets[g * HASH_TABLE_GROUP_WIDTH + lowest_set_bit_index(match)];
+                if (hash_keys_match(bucket->key, key)) return bucket;
+                match &= match - 1;
+            }
 
-        auto hk = hash(key) & (allocated - 1);
-        while (occupancy_mask[hk] && buckets[hk].key != key) {
-            hk = (hk + 1) & (allocated - 1);
+            if (hash_group_match_empty(group)) break;
+            g = (g + 1) & mask;
         }
 
-        occupancy_mask[hk] = true;
-        buckets[hk].key = key;
-        buckets[hk].value = value;
-        count++;
+        return nullptr;
     }
 
-    inline Value *find(Key key) {
-        auto hk = hash(key) & (allocated - 1);
-        for (int i = 0; i < allocated && occupancy_mask[hk] && buckets[hk].key != key; i++) {
-            hk = (hk + 1) & (allocated - 1);
+    inline Bucket *find_bucket(Key key) {
+        return find_bucket(key, hash(key));
+    }
+
+    // Returns the existing bucket for key, or inserts one with an uninitialized value.
+    inline Bucket *find_or_add_bucket(Key key, bool *added) {
+        u64 h = hash(key);
+        Bucket *bucket = find_bucket(key, h);
+        if (bucket) {
+            if (added) *added = false;
+            return bucket;
         }
 
-        if (buckets && occupancy_mask[hk] && buckets[hk].key == key) {
-            return &buckets[hk].value;
-        } else {
-            return nullptr;
+        // Keep the load factor at or below 7/8.
+        if (!allocated || (count + 1) * 8 > allocated * 7) {
+            grow();
         }
+
+        if (added) *added = true;
+        return insert_new(key, h);
     }
-};
 
-template <typename Value>
-struct String_Hash_Table {
-    struct Bucket {
-        char *key;
-        Value value;
-    };
+    inline void add(Key key, Value value) {
+        Bucket *bucket = find_or_add_bucket(key, nullptr);
+        bucket->value = value;
+    }
 
-    Bucket *buckets = nullptr;
-    bool *occupancy_mask = nullptr;
-    int allocated = 0;
-    int count = 0;
+    inline Value *find(Key key) {
+        Bucket *bucket = find_bucket(key);
+        if (bucket) return &bucket->value;
+        return nullptr;
+    }
 
-    inline void grow() {
-        const int HASH_TABLE_INITIAL_CAPACITY = 256;
-
-        if (!buckets) {
-            assert(allocated == 0);
-            assert(count == 0);
-            
-            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
-            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
-            allocated = HASH_TABLE_INITIAL_CAPACITY;
-            count = 0;
-        } else {
-            String_Hash_Table <Value> new_hash_table = {
-                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
-                (bool *)calloc(allocated * 2, sizeof(bool)),
-                allocated * 2,
-                0,
-            };
-
-            for (int i = 0; i < count; i++) {
-                if (occupancy_mask[i]) {
-                    new_hash_table.add(buckets[i].key, buckets[i].value);
-                }
-            }
+    inline void remove_bucket(Bucket *bucket) {
+        int mask = group_mask();
+        int hole = (int)(bucket - buckets);
+        int hole_group = hole / HASH_TABLE_GROUP_WIDTH;
+
+        bool group_was_full = hash_group_match_empty(control + hole_group * HASH_TABLE_GROUP_WIDTH) == 0;
+        control[hole] = HASH_TABLE_EMPTY;
+        count--;
+
+        // Nothing could have probed past a group that had room, so nothing needs to move.
+        if (!group_was_full) return;
+
+        int g = (hole_group + 1) & mask;
+        for (int probe = 0; probe < mask; probe++, g = (g + 1) & mask) {
+            u8 *group = control + g * HASH_TABLE_GROUP_WIDTH;
+            u32 empty = hash_group_match_empty(group);
+            u32 full = ~empty & 0xffff;
+            int hole_distance = (g - hole_group) & mask;
 
-            free(buckets);
-            free(occupancy_mask);
+            while (full) {
+                int slot = g * HASH_TABLE_GROUP_WIDTH + lowest_set_bit_index(full);
+                full &= full - 1;
+
+                // Entries whose home group is at or before the hole probed through it.
+                int home = home_group(hash(buckets[slot].key));
+                if (((g - home) & mask) < hole_distance) continue;
+
+                control[hole] = control[slot];
+                buckets[hole] = buckets[slot];
+                control[slot] = HASH_TABLE_EMPTY;
+
+                hole = slot;
+                hole_group = g;
+                break;
+            }
 
-            *this = new_hash_table;
+            // A group that already had room ends every probe sequence running through it.
+            if (empty) break;
         }
     }
 
+    inline bool remove(Key key) {
+        Bucket *bucket = find_bucket(key);
+        if (!bucket) return false;
+        remove_bucket(bucket);
+        return true;
+    }
+
+    // Removes every entry but keeps the memory.
+    inline void reset() {
+        if (control) memset(control, HASH_TABLE_EMPTY, allocated);
+        count = 0;
+    }
+
+    inline void deinit() {
+        free(control);
+        free(buckets);
+        control = nullptr;
+        buckets = nullptr;
+        allocated = 0;
+        count = 0;
+    }
+};
+
+// Owns copies of its keys.
+template <typename Value>
+struct String_Hash_Table : public Hash_Table <char *, Value> {
+    using Bucket = typename Hash_Table <char *, Value>::Bucket;
+
     inline void add(char *key, Value value) {
-        if (count >= allocated) {
-            grow();
-        }
+        bool added = false;
+        Bucket *bucket = this->find_or_add_bucket(key, &added);
+        if (added) bucket->key = copy_string(key);
+        bucket->value = value;
+    }
 
-        auto hk = hash(key) & (allocated - 1);
-        while (occupancy_mask[hk] && !strings_match(buckets[hk].key, key)) {
-            hk = (hk + 1) & (allocated - 1);
-        }
+    inline bool remove(char *key) {
+        Bucket *bucket = this->find_bucket(key);
+        if (!bucket) return false;
 
-        occupancy_mask[hk] = true;
-        buckets[hk].key = copy_string(key);
-        buckets[hk].value = value;
-        count++;
+        char *owned_key = bucket->key;
+        this->remove_bucket(bucket);
+        delete [] owned_key;
+        return true;
     }
 
-    inline Value *find(char *key) {
-        auto hk = hash(key) & (allocated - 1);
-        for (int i = 0; i < allocated && occupancy_mask[hk] && strcmp(buckets[hk].key, key); i++) {
-            hk = (hk + 1) & (allocated - 1);
+    inline void free_keys() {
+        for (int i = 0; i < this->allocated; i++) {
+            if (this->control[i] != HASH_TABLE_EMPTY) delete [] this->buckets[i].key;
         }
+    }
 
-        if (buckets && occupancy_mask[hk] && !strcmp(buckets[hk].key, key)) {
-            return &buckets[hk].value;
-        } else {
-            return nullptr;
-        }
+    inline void reset() {
+        free_keys();
+        Hash_Table <char *, Value>::reset();
+    }
+
+    inline void deinit() {
+        free_keys();
+        Hash_Table <char *, Value>::deinit();
     }
 };
@@ -0,0 +1,526 @@
+#include "pch.h"
+
+#ifdef BUILD_HEADLESS
+
+//
+// Runs the simulation without a window or a renderer, as fast as it will go: for soak tests
+// and for measuring how long a tick takes. Build it with build_headless.sh, which links the
+// null renderer instead of the D3D11 one.
+//
+// Input comes from a script instead of the keyboard. A script is a text file like this:
+//
+//     [1] # Version number
+//     length 480
+//     0   press   move_right
+//     120 release move_right
+//
+// Each line presses or releases a keymap action at the given tick. With a length, the script
+// starts over every length ticks. Without a script the guy walks around in a square.
+//
+// With -draw every tick also draws a frame through the null renderer, which doesn't draw
+// anything but counts the draw calls and vertices the real one would have.
+//
+// With -catchup the ticks go through the game's fixed-step loop instead, as if each took a
+// given number of milliseconds, to check how it catches up when it falls behind.
+//
+// With -bench or -jobs it runs one of the microbenchmarks in benchmarks.cpp instead of the game.
+//
+
+#include "game.h"
+#include "os.h"
+#include "render.h"
+#include "render_backend.h" // For null_replay_counts.
+#include "draw.h"
+#include "light_bins.h"
+#include "shadow_segments.h"
+#include "sprite_batch.h"
+#include "jobs.h"
+#include "keymap.h"
+#include "entity_manager.h"
+#include "entities.h"
+#include "text_file_handler.h"
+#include "variable_service.h"
+
+#include "shader_registry.h"
+#include "texture_registry.h"
+#include "animation_registry.h"
+#include "benchmarks.h"
+
+#define INPUT_SCRIPT_FILE_VERSION 1
+
+struct Input_Script_Event {
+    int tick;
+    bool press;
+    char *action_name;
+};
+
+struct Input_Script {
+    int length = 0; // 0 means the script only runs once.
+    Array <Input_Script_Event> events;
+};
+
+static Input_Script_Event default_script_events[] = {
+    {   0, true,  "move_right" },
+    { 120, false, "move_right" },
+    { 120, true,  "move_up" },
+    { 240, false, "move_up" },
+    { 240, true,  "move_left" },
+    { 360, false, "move_left" },
+    { 360, true,  "move_down" },
+    { 480, false, "move_down" },
+};
+
+static Key_Action *find_key_action(Keymap *keymap, char *name) {
+    if (strings_match(name, "move_left")) return &keymap->move_left;
+    if (strings_match(name, "move_right")) return &keymap->move_right;
+    if (strings_match(name, "move_up")) return &keymap->move_up;
+    if (strings_match(name, "move_down")) return &keymap->move_down;
+    if (strings_match(name, "save_current_game_mode")) return &keymap->save_current_game_mode;
+    if (strings_match(name, "toggle_fullscreen")) return &keymap->toggle_fullscreen;
+    if (strings_match(name, "toggle_editor")) return &keymap->toggle_editor;
+    return NULL;
+}
+
+static int compare_script_events(const void *a, const void *b) {
+    auto ea = (Input_Script_Event *)a;
+    auto eb = (Input_Script_Event *)b;
+    return ea->tick - eb->tick;
+}
+
+static bool load_input_script(Input_Script *script, char *filepath) {
+    Text_File_Handler handler;
+    handler.start_file(filepath, filepath, "load_input_script");
+    if (handler.failed) return false;
+
+    if (handler.version > INPUT_SCRIPT_FILE_VERSION) {
+        handler.report_error("Version number too high (%d), the highest we know about is %d.\n", handler.version, INPUT_SCRIPT_FILE_VERSION);
+        return false;
+    }
+
+    while (true) {
+        char *line = handler.consume_next_line();
+        if (!line) break;
+
+        if (starts_with(line, "length")) {
+            sscanf(line, "length %d", &script->length);
+            continue;
+        }
+
+        int tick = -1;
+        char verb[64] = {};
+        char action_name[64] = {};
+        if (sscanf(line, "%d %63s %63s", &tick, verb, action_name) != 3 || tick < 0) {
+            handler.report_error("Expected '<tick> press|release <action>', got '%s'.\n", line);
+            continue;
+        }
+
+        if (!strings_match(verb, "press") && !strings_match(verb, "release")) {
+            handler.report_error("Unknown verb '%s', expected press or release.\n", verb);
+            continue;
+        }
+
+        if (!find_key_action(globals.keymap, action_name)) {
+            handler.report_error("Unknown keymap action '%s'.\n", action_name);
+            continue;
+        }
+
+        Input_Script_Event event;
+        event.tick = tick;
+        event.press = strings_match(verb, "press");
+        event.action_name = copy_string(action_name);
+        script->events.add(event);
+    }
+
+    // Stable enough for us: events on the same tick don't depend on each other's order.
+    qsort(script->events.data, script->events.count, sizeof(Input_Script_Event), compare_script_events);
+
+    return true;
+}
+
+static void apply_script_events(Input_Script *script, s64 tick) {
+    s64 script_tick = tick;
+    if (script->length > 0) script_tick = tick % script->length;
+
+    for (Input_Script_Event &event : script->events) {
+        if (event.tick < script_tick) continue;
+        if (event.tick > script_tick) break;
+
+        Key_Action *action = find_key_action(globals.keymap, event.action_name);
+        set_key_state(action->key_code, event.press);
+        if (action->alt_down) set_key_state(KEY_ALT, event.press);
+        if (action->shift_down) set_key_state(KEY_SHIFT, event.press);
+        if (action->ctrl_down) set_key_state(KEY_CTRL, event.press);
+    }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(double *)a;
+    double db = *(double *)b;
+    if (da < db) return -1;
+    if (da > db) return 1;
+    return 0;
+}
+
+static double percentile(Array <double> *sorted, double p) {
+    if (!sorted->count) return 0.0;
+
+    s64 index = (s64)(p * (sorted->count - 1) + 0.5);
+    index = Clamp(index, (s64)0, (s64)(sorted->count - 1));
+    return (*sorted)[index];
+}
+
+struct Draw_Totals {
+    s64 num_frames = 0;
+    s64 num_draw_calls = 0;
+    s64 num_vertices = 0;
+    s64 num_bytes_uploaded = 0;
+    s64 num_commands = 0;
+    s64 num_command_bytes = 0;
+    int max_draw_calls = 0;
+    double draw_time = 0.0;
+    Culling_Stats culling; // Summed over the frames.
+    s64 num_lit_tiles = 0;
+    int max_lights_in_a_tile = 0;
+    Shadow_Stats shadows; // Summed over the frames.
+    Sprite_Sort_Stats sprite_sorts; // Summed over the frames.
+};
+
+// Prints the timings of the ticks in tick_times and then forgets them.
+static void report_tick_times(Array <double> *tick_times, double wall_time, s64 total_ticks, Draw_Totals *draw_totals) {
+    if (!tick_times->count) return;
+
+    qsort(tick_times->data, tick_times->count, sizeof(double), compare_doubles);
+
+    double ms = 1000.0;
+    print("%lld ticks in %.3fs, %.0f ticks/sec (%.1fx real time).\n",
+          (long long)tick_times->count, wall_time, tick_times->count / wall_time,
+          (tick_times->count * (double)get_gameplay_dt()) / wall_time);
+    print("    per tick: min %.4fms  p50 %.4fms  p90 %.4fms  p99 %.4fms  p99.9 %.4fms  max %.4fms\n",
+          percentile(tick_times, 0.0) * ms, percentile(tick_times, 0.5) * ms,
+          percentile(tick_times, 0.9) * ms, percentile(tick_times, 0.99) * ms,
+          percentile(tick_times, 0.999) * ms, percentile(tick_times, 1.0) * ms);
+
+    auto manager = get_entity_manager();
+    print("    %lld ticks total, %d entities, temporary storage peak %lld bytes.\n",
+          (long long)total_ticks, manager->all_entities.count,
+          (long long)get_temporary_storage_high_water_mark());
+
+    if (draw_totals->num_frames) {
+        double num_frames = (double)draw_totals->num_frames;
+        print("    per frame: %.1f draw calls (max %d), %.0f vertices, %.0f bytes uploaded, %.4fms to draw.\n",
+              draw_totals->num_draw_calls / num_frames, draw_totals->max_draw_calls,
+              draw_totals->num_vertices / num_frames, draw_totals->num_bytes_uploaded / num_frames,
+              draw_totals->draw_time / num_frames * 1000.0);
+        print("    recorded per frame: %.0f commands, %.0f bytes.\n",
+              draw_totals->num_commands / num_frames, draw_totals->num_command_bytes / num_frames);
+
+        wait_for_render_thread();
+        Null_Replay_Counts *r = &null_replay_counts;
+        print("    replayed in all: %lld frames, %lld state changes, %lld draw calls, %lld vertices, %lld bytes uploaded.\n",
+              (long long)r->num_frames, (long long)r->num_state_changes, (long long)r->num_draw_calls,
+              (long long)r->num_vertices, (long long)r->num_bytes_uploaded);
+
+        Culling_Stats *c = &draw_totals->culling;
+        print("    drawn/culled per frame: chunks %.1f/%.1f  sprites %.1f/%.1f  lights %.1f/%.1f\n",
+              c->chunks_drawn / num_frames, c->chunks_culled / num_frames,
+              c->sprites_submitted / num_frames, c->sprites_culled / num_frames,
+              c->lights_submitted / num_frames, c->lights_culled / num_frames);
+        print("    light bins: %.1f lit tiles per frame, at most %d lights in a tile.\n",
+              draw_totals->num_lit_tiles / num_frames, draw_totals->max_lights_in_a_tile);
+
+        Shadow_Stats *s = &draw_totals->shadows;
+        print("    shadows per frame: %.1f lights with shadows, %.1f rebuilt, %.1f edges. %d rebuilt in all.\n",
+              s->lights_with_shadows / num_frames, s->lights_rebuilt / num_frames, s->edges_drawn / num_frames, s->lights_rebuilt);
+
+        Sprite_Sort_Stats *sorts = &draw_totals->sprite_sorts;
+        print("    sprite sorts: %d incremental, %d radix, %.1f keys moved per frame.\n",
+              sorts->incremental_sorts, sorts->radix_sorts, sorts->keys_moved / num_frames);
+        *draw_totals = Draw_Totals();
+    }
+
+    tick_times->clear();
+    fflush(stdout);
+}
+
+// Goes through the game's own fixed-step loop (simulate_pending_ticks) instead of calling
+// simulate_game directly, pretending that every tick takes tick_ms of real time: a frame lasts
+// as long as the ticks it ran, but at least one GAMEPLAY_DT like it would with vsync. When
+// ticks are slower than GAMEPLAY_DT the game can't keep up, and this checks that it catches
+// up by at most max_ticks_per_frame ticks a frame and that the time it gives up is all
+// accounted for in the telemetry. There is no input, the guy stands still.
+static bool run_catch_up_check(s64 num_frames, double tick_ms) {
+    Time_Info *info = &globals.time_info;
+    int max_ticks = Max(globals.max_ticks_per_frame, 1);
+    double tick_time = tick_ms / 1000.0;
+    bool should_fall_behind = tick_time > GAMEPLAY_DT;
+
+    s64 frames_over_budget_before = info->num_frames_over_budget;
+    double dropped_time_before = info->dropped_time;
+
+    double real_time = 0.0;
+    s64 total_ticks = 0;
+    int most_ticks_in_a_frame = 0;
+    int ticks_last_frame = 0;
+    bool success = true;
+
+    for (s64 frame = 0; frame < num_frames; frame++) {
+        reset_temporary_storage();
+        begin_key_frame();
+
+        double frame_dt = Max(ticks_last_frame * tick_time, GAMEPLAY_DT);
+        real_time += frame_dt;
+        simulate_pending_ticks(frame_dt);
+
+        int ticks = info->ticks_this_frame;
+        if (ticks > max_ticks) {
+            log_error("Frame %lld ran %d ticks, more than max_ticks_per_frame (%d).\n", (long long)frame, ticks, max_ticks);
+            success = false;
+        }
+
+        if (globals.render_alpha < 0.0f || globals.render_alpha >= 1.0f) {
+            log_error("Frame %lld left render_alpha at %f, outside [0, 1).\n", (long long)frame, globals.render_alpha);
+            success = false;
+        }
+
+        total_ticks += ticks;
+        most_ticks_in_a_frame = Max(most_ticks_in_a_frame, ticks);
+        ticks_last_frame = ticks;
+    }
+
+    s64 frames_over_budget = info->num_frames_over_budget - frames_over_budget_before;
+    double dropped_time = info->dropped_time - dropped_time_before;
+    double game_time = total_ticks * GAMEPLAY_DT;
+    double leftover_time = globals.render_alpha * GAMEPLAY_DT;
+
+    print("%lld frames at %.3fms per tick, at most %d ticks per frame.\n", (long long)num_frames, tick_ms, max_ticks);
+    print("    %.3fs of real time, %lld ticks = %.3fs of game time (%.2fx real time, %.2fx expected).\n",
+          real_time, (long long)total_ticks, game_time, game_time / real_time,
+          should_fall_behind ? GAMEPLAY_DT / tick_time : 1.0);
+    print("    dropped %.3fs = %lld ticks over %lld frames, at most %d ticks in a frame.\n",
+          dropped_time, (long long)(dropped_time / GAMEPLAY_DT + 0.5), (long long)frames_over_budget, most_ticks_in_a_frame);
+
+    // Every bit of real time went into a tick, got dropped, or is still waiting for the next frame.
+    double unaccounted_time = real_time - (game_time + dropped_time + leftover_time);
+    if (fabs(unaccounted_time) > 1e-6) {
+        log_error("%.9fs of real time went neither into ticks nor into dropped_time.\n", unaccounted_time);
+        success = false;
+    }
+
+    if (should_fall_behind && (frames_over_budget == 0 || most_ticks_in_a_frame != max_ticks)) {
+        log_error("Ticks are slower than real time, but the simulation never hit the catch-up cap.\n");
+        success = false;
+    }
+
+    if (!should_fall_behind && frames_over_budget != 0) {
+        log_error("Ticks keep up with real time, but %lld frames still dropped time.\n", (long long)frames_over_budget);
+        success = false;
+    }
+
+    if (success) print("    Catch-up checks passed.\n");
+    else print("    Catch-up checks FAILED.\n");
+    return success;
+}
+
+static void print_usage() {
+    fprintf(stderr, "headless [-ticks N] [-input <script>] [-report N] [-workers N] [-draw] [-catchup MS]\n");
+    fprintf(stderr, "    -ticks N     Number of ticks to simulate, 0 runs until killed (default 36000).\n");
+    fprintf(stderr, "    -input path  Input script, relative to the run_tree (default: walk in a square).\n");
+    fprintf(stderr, "    -report N    Print timings every N ticks (default: only at the end, 36000 with -ticks 0).\n");
+    fprintf(stderr, "    -workers N   Number of job system workers (default: one per extra hardware thread).\n");
+    fprintf(stderr, "    -draw        Also draw every tick with the null renderer and report draw calls.\n");
+    fprintf(stderr, "    -catchup MS  Run -ticks frames through the fixed-step loop as if every tick took MS\n");
+    fprintf(stderr, "                 milliseconds, and check the catch-up cap and the dropped time.\n");
+    fprintf(stderr, "    -jobs        Like -bench jobs, but for 0 to -workers workers.\n");
+    fprintf(stderr, "    -bench name  Run a microbenchmark instead of the game:");
+    for (int i = 0; i < NUM_BENCHMARKS; i++) fprintf(stderr, " %s", benchmarks[i].name);
+    fprintf(stderr, ".\n");
+}
+
+int main(int argc, char **argv) {
+    s64 num_ticks = 60 * 60 * 10;
+    s64 report_interval = 0;
+    int num_workers = -1;
+    char *input_script_path = NULL;
+    bool should_draw = false;
+    char *benchmark_name = NULL;
+    bool should_benchmark_jobs = false;
+    double catch_up_tick_ms = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strings_match(argv[i], "-ticks") && has_value) {
+            num_ticks = atoll(argv[++i]);
+        } else if (strings_match(argv[i], "-input") && has_value) {
+            input_script_path = argv[++i];
+        } else if (strings_match(argv[i], "-report") && has_value) {
+            report_interval = atoll(argv[++i]);
+        } else if (strings_match(argv[i], "-workers") && has_value) {
+            num_workers = atoi(argv[++i]);
+        } else if (strings_match(argv[i], "-draw")) {
+            should_draw = true;
+        } else if (strings_match(argv[i], "-catchup") && has_value) {
+            catch_up_tick_ms = atof(argv[++i]);
+        } else if (strings_match(argv[i], "-jobs")) {
+            should_benchmark_jobs = true;
+        } else if (strings_match(argv[i], "-bench") && has_value) {
+            benchmark_name = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown or incomplete argument '%s'.\n", argv[i]);
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (num_ticks <= 0 && report_interval <= 0) report_interval = 60 * 60 * 10;
+
+    init_temporary_storage(40000);
+    init_colors_and_utf8();
+
+    if (should_benchmark_jobs) return benchmark_jobs(num_workers) ? 0 : 1;
+
+    if (benchmark_name) {
+        Benchmark *benchmark = find_benchmark(benchmark_name);
+        if (!benchmark) {
+            fprintf(stderr, "Unknown benchmark '%s'.\n", benchmark_name);
+            print_usage();
+            return 1;
+        }
+        return benchmark->proc() ? 0 : 1;
+    }
+
+    init_job_system(num_workers);
+
+    {
+        char *path = get_path_of_running_executable();
+        defer { delete [] path; };
+
+        char *slash = strrchr(path, '/');
+        if (slash) path[slash - path] = 0;
+
+        setcwd(path);
+    }
+
+    globals.last_time = get_time();
+
+    globals.display_width = 1600;
+    globals.display_height = 900;
+    init_render(NULL, globals.display_width, globals.display_height, false);
+
+    globals.shader_registry = new Shader_Registry();
+    globals.texture_registry = new Texture_Registry();
+    globals.animation_registry = new Animation_Registry();
+
+    globals.texture_registry->load_atlas("textures");
+
+    load_vars_file(globals.variable_service, "data/All.vars"); // @ReturnValueIgnored
+
+    init_game();
+    if (!globals.current_game_mode) {
+        log_error("Failed to load the game mode.\n");
+        return 1;
+    }
+
+    if (should_draw) {
+        init_shaders();
+
+        Tilemap *tilemap = get_entity_manager()->tilemap;
+        globals.render_area = aspect_ratio_fit(globals.display_width, globals.display_height, tilemap->width, tilemap->height);
+        globals.render_width = globals.render_area.width;
+        globals.render_height = globals.render_area.height;
+
+        the_lightmap_buffer = create_color_target(globals.render_width, globals.render_height);
+        the_offscreen_buffer = create_color_target(globals.render_width, globals.render_height);
+    }
+
+    if (catch_up_tick_ms > 0.0) {
+        bool success = run_catch_up_check(Max(num_ticks, (s64)1), catch_up_tick_ms);
+
+        shutdown_render();
+        shutdown_job_system();
+        return success ? 0 : 1;
+    }
+
+    Input_Script script;
+    if (input_script_path) {
+        if (!load_input_script(&script, input_script_path)) return 1;
+    } else {
+        script.length = 480;
+        for (Input_Script_Event event : default_script_events) script.events.add(event);
+    }
+
+    Draw_Totals draw_totals;
+    Array <double> tick_times;
+    tick_times.reserve((int)Min(report_interval > 0 ? report_interval : num_ticks, (s64)1000000));
+
+    if (num_ticks > 0) log("Running %lld ticks headless.\n", (long long)num_ticks);
+    else log("Running headless until killed.\n");
+
+    double start_time = get_time();
+    double report_start_time = start_time;
+
+    for (s64 tick = 0; num_ticks <= 0 || tick < num_ticks; tick++) {
+        reset_temporary_storage();
+
+        begin_key_frame();
+        apply_script_events(&script, tick);
+
+        double tick_start = get_time();
+        simulate_game();
+        double tick_end = get_time();
+
+        tick_times.add(tick_end - tick_start);
+
+        if (should_draw) {
+            double draw_start = get_time();
+            draw_one_frame();
+            draw_totals.draw_time += get_time() - draw_start;
+
+            draw_totals.num_frames += 1;
+            draw_totals.num_draw_calls += render_stats.num_draw_calls;
+            draw_totals.num_vertices += render_stats.num_vertices;
+            draw_totals.num_bytes_uploaded += render_stats.num_bytes_uploaded;
+            draw_totals.num_commands += render_stats.num_commands;
+            draw_totals.num_command_bytes += render_stats.num_command_bytes;
+            draw_totals.max_draw_calls = Max(draw_totals.max_draw_calls, render_stats.num_draw_calls);
+
+            Culling_Stats *c = &draw_totals.culling;
+            c->chunks_drawn += culling_stats.chunks_drawn;
+            c->chunks_culled += culling_stats.chunks_culled;
+            c->sprites_submitted += culling_stats.sprites_submitted;
+            c->sprites_culled += culling_stats.sprites_culled;
+            c->lights_submitted += culling_stats.lights_submitted;
+            c->lights_culled += culling_stats.lights_culled;
+
+            draw_totals.num_lit_tiles += light_bins.num_lit_tiles;
+            draw_totals.max_lights_in_a_tile = Max(draw_totals.max_lights_in_a_tile, light_bins.max_lights_in_a_tile);
+
+            Shadow_Stats *s = &draw_totals.shadows;
+            s->lights_with_shadows += shadow_stats.lights_with_shadows;
+            s->lights_rebuilt += shadow_stats.lights_rebuilt;
+            s->edges_drawn += shadow_stats.edges_drawn;
+
+            Sprite_Sort_Stats *sorts = &draw_totals.sprite_sorts;
+            sorts->incremental_sorts += sprite_sort_stats.incremental_sorts;
+            sorts->radix_sorts += sprite_sort_stats.radix_sorts;
+            sorts->keys_moved += sprite_sort_stats.keys_moved;
+
+            double swap_start = get_time();
+            swap_buffers();
+            draw_totals.draw_time += get_time() - swap_start;
+        }
+
+        if (report_interval > 0 && (tick + 1) % report_interval == 0) {
+            report_tick_times(&tick_times, get_time() - report_start_time, tick + 1, &draw_totals);
+            report_start_time = get_time();
+        }
+    }
+
+    report_tick_times(&tick_times, get_time() - report_start_time, num_ticks, &draw_totals);
+
+    shutdown_render();
+    shutdown_job_system();
+
+    return 0;
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "render.h"
 #include "font.h"
 #include "draw.h"
+#include "light_bins.h"
 
 const double NUM_SECONDS_BETWEEN_UPDATES = 0.05;
 static double num_seconds_since_last_update;
@@ -12,6 +13,8 @@ static double accumulated_dt;
 static double dt_for_draw;
 
 static void draw_fps() {
+    Render_Stats scene_stats = render_stats; // Before the HUD adds its own.
+    
     set_shader(globals.shader_text);
 
     float dt = globals.time_info.ui_dt;
@@ -41,6 +44,20 @@ static void draw_fps() {
     
     draw_text(font, text, x+offset, y-offset, Vector4(0, 0, 0, 1));
     draw_text(font, text, x, y, Vector4(1, 1, 1, 1));
+
+    text = tprint("%d draw calls, %lld vertices", scene_stats.num_draw_calls, (long long)scene_stats.num_vertices);
+    x = globals.render_width - font->get_string_width_in_pixels(text);
+    y -= font->character_height;
+    
+    draw_text(font, text, x+offset, y-offset, Vector4(0, 0, 0, 1));
+    draw_text(font, text, x, y, Vector4(1, 1, 1, 1));
+
+    text = tprint("%d lights, %d lit tiles, at most %d per tile", culling_stats.lights_submitted, light_bins.num_lit_tiles, light_bins.max_lights_in_a_tile);
+    x = globals.render_width - font->get_string_width_in_pixels(text);
+    y -= font->character_height;
+    
+    draw_text(font, text, x+offset, y-offset, Vector4(0, 0, 0, 1));
+    draw_text(font, text, x, y, Vector4(1, 1, 1, 1));
 }
 
 void draw_hud() {
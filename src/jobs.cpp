@@ -0,0 +1,332 @@
+#include "pch.h"
+#include "jobs.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// The deques are Chase-Lev deques with a fixed capacity, using the C11 orderings from
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013). A thief
+// copies the job before it tries to claim it, and throws the copy away if the claim fails.
+// That copy can race with the owner reusing the slot, which is why slots are made of relaxed
+// atomics instead of a plain Job.
+//
+
+const int JOB_DEQUE_CAPACITY = 4096; // Must be a power of two.
+const int JOB_SPINS_BEFORE_SLEEPING = 64;
+
+struct Job_Slot {
+    std::atomic <Job_Proc> proc;
+    std::atomic <void *> data;
+    std::atomic <int> begin;
+    std::atomic <int> end;
+    std::atomic <Job_Counter *> counter;
+
+    void store(Job job) {
+        proc.store(job.proc, std::memory_order_relaxed);
+        data.store(job.data, std::memory_order_relaxed);
+        begin.store(job.begin, std::memory_order_relaxed);
+        end.store(job.end, std::memory_order_relaxed);
+        counter.store(job.counter, std::memory_order_relaxed);
+    }
+
+    Job load() {
+        Job job;
+        job.proc = proc.load(std::memory_order_relaxed);
+        job.data = data.load(std::memory_order_relaxed);
+        job.begin = begin.load(std::memory_order_relaxed);
+        job.end = end.load(std::memory_order_relaxed);
+        job.counter = counter.load(std::memory_order_relaxed);
+        return job;
+    }
+};
+
+struct Job_Deque {
+    alignas(64) std::atomic <s64> top { 0 };
+    alignas(64) std::atomic <s64> bottom { 0 };
+    Job_Slot slots[JOB_DEQUE_CAPACITY];
+
+    // Owner only.
+    bool push(Job job) {
+        s64 b = bottom.load(std::memory_order_relaxed);
+        s64 t = top.load(std::memory_order_acquire);
+        if (b - t >= JOB_DEQUE_CAPACITY) return false;
+
+        slots[b & (JOB_DEQUE_CAPACITY - 1)].store(job);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only.
+    bool pop(Job *job) {
+        s64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        *job = slots[b & (JOB_DEQUE_CAPACITY - 1)].load();
+        if (t < b) return true;
+
+        // Last job, race the thieves for it.
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(Job *job) {
+        s64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s64 b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        Job copy = slots[t & (JOB_DEQUE_CAPACITY - 1)].load();
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return false;
+
+        *job = copy;
+        return true;
+    }
+};
+
+static int num_job_threads = 0; // 0 until init_job_system, jobs then run right away.
+static Job_Deque *deques = NULL;
+static std::thread *workers = NULL;
+
+static thread_local int job_thread_index = -1;
+
+static std::atomic <bool> quitting { false };
+static std::atomic <int> num_queued_jobs { 0 };
+static std::atomic <int> num_sleeping_workers { 0 };
+static std::mutex sleep_mutex;
+static std::condition_variable wake_up;
+
+static void queue_job(Job job);
+
+// Sets JOB_COUNTER_LOCKED and returns the number of jobs the counter had. The count can still
+// go up while it's locked, and down, but not to zero.
+static int lock_job_counter(Job_Counter *counter) {
+    while (true) {
+        int value = counter->value.load(std::memory_order_relaxed);
+        if (!(value & JOB_COUNTER_LOCKED) && counter->value.compare_exchange_weak(value, value | JOB_COUNTER_LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return value;
+        }
+        std::this_thread::yield();
+    }
+}
+
+static void unlock_job_counter(Job_Counter *counter) {
+    counter->value.fetch_and(~JOB_COUNTER_LOCKED, std::memory_order_release);
+}
+
+// The last job takes the counter to zero with the lock held, so that it can take the jobs that
+// depend on the counter without racing a run_job that is adding one. Unlocking is the last time
+// it touches the counter, since whoever waits on the counter may free it right after.
+static void finish_job_on_counter(Job_Counter *counter) {
+    while (true) {
+        int value = counter->value.load(std::memory_order_relaxed);
+        int count = value & ~JOB_COUNTER_LOCKED;
+        assert(count > 0);
+
+        if (count > 1) {
+            if (counter->value.compare_exchange_weak(value, value - 1, std::memory_order_release, std::memory_order_relaxed)) return;
+            continue;
+        }
+
+        if (value & JOB_COUNTER_LOCKED) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (counter->value.compare_exchange_weak(value, JOB_COUNTER_LOCKED, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            Deferred_Job *deferred = counter->waiting_jobs;
+            counter->waiting_jobs = nullptr;
+            unlock_job_counter(counter);
+
+            while (deferred) {
+                Deferred_Job *next = deferred->next;
+                queue_job(deferred->job);
+                delete deferred;
+                deferred = next;
+            }
+            return;
+        }
+    }
+}
+
+static void execute_job(Job *job) {
+    // Whatever the job puts in temporary storage is gone once it returns.
+    Temporary_Storage_Scope scope;
+
+    job->proc(job->data, job->begin, job->end);
+    if (job->counter) finish_job_on_counter(job->counter);
+}
+
+static bool get_job(Job *job) {
+    int index = job_thread_index;
+    if (deques[index].pop(job)) {
+        num_queued_jobs.fetch_sub(1);
+        return true;
+    }
+
+    for (int i = 1; i < num_job_threads; i++) {
+        int victim = (index + i) % num_job_threads;
+        if (deques[victim].steal(job)) {
+            num_queued_jobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void worker_main(int index) {
+    job_thread_index = index;
+
+    int spins = 0;
+    while (!quitting.load()) {
+        Job job;
+        if (get_job(&job)) {
+            execute_job(&job);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < JOB_SPINS_BEFORE_SLEEPING) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // run_job bumps num_queued_jobs before it looks at num_sleeping_workers, and we do the
+        // opposite, so one of the two always sees the other and no wake up gets lost.
+        std::unique_lock <std::mutex> lock(sleep_mutex);
+        num_sleeping_workers.fetch_add(1);
+        wake_up.wait(lock, [] { return num_queued_jobs.load() > 0 || quitting.load(); });
+        num_sleeping_workers.fetch_sub(1);
+        spins = 0;
+    }
+}
+
+void init_job_system(int num_workers) {
+    assert(!num_job_threads);
+
+    if (num_workers < 0) {
+        int hardware_threads = (int)std::thread::hardware_concurrency();
+        num_workers = Max(hardware_threads - 1, 0);
+    }
+
+    num_job_threads = num_workers + 1;
+    deques = new Job_Deque[num_job_threads];
+    job_thread_index = 0;
+
+    quitting.store(false);
+    workers = new std::thread[num_workers];
+    for (int i = 0; i < num_workers; i++) {
+        workers[i] = std::thread(worker_main, i + 1);
+    }
+
+    log("Job system started with %d worker threads.\n", num_workers);
+}
+
+void shutdown_job_system() {
+    if (!num_job_threads) return;
+
+    {
+        std::lock_guard <std::mutex> lock(sleep_mutex);
+        quitting.store(true);
+    }
+    wake_up.notify_all();
+
+    for (int i = 0; i < num_job_threads - 1; i++) workers[i].join();
+
+    delete [] workers;
+    delete [] deques;
+    workers = NULL;
+    deques = NULL;
+    num_job_threads = 0;
+}
+
+int get_num_job_threads() {
+    return Max(num_job_threads, 1);
+}
+
+// Queues a job that its counter already counts.
+static void queue_job(Job job) {
+    if (!num_job_threads) {
+        execute_job(&job);
+        return;
+    }
+
+    assert(job_thread_index >= 0); // Only the main thread and jobs can submit jobs.
+
+    num_queued_jobs.fetch_add(1);
+    if (!deques[job_thread_index].push(job)) {
+        num_queued_jobs.fetch_sub(1);
+        execute_job(&job);
+        return;
+    }
+
+    if (num_sleeping_workers.load() > 0) {
+        std::lock_guard <std::mutex> lock(sleep_mutex);
+        wake_up.notify_one();
+    }
+}
+
+void run_job(Job_Proc proc, void *data, Job_Counter *counter, int begin, int end, Job_Counter *depends_on) {
+    Job job;
+    job.proc = proc;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = counter;
+
+    if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    if (depends_on) {
+        // The lock keeps depends_on from hitting zero until the job is on its list.
+        if (lock_job_counter(depends_on)) {
+            Deferred_Job *deferred = new Deferred_Job();
+            deferred->job = job;
+            deferred->next = depends_on->waiting_jobs;
+            depends_on->waiting_jobs = deferred;
+            unlock_job_counter(depends_on);
+            return;
+        }
+        unlock_job_counter(depends_on);
+    }
+
+    queue_job(job);
+}
+
+void wait_for_counter(Job_Counter *counter) {
+    // Also waits out JOB_COUNTER_LOCKED, so that the counter is free to go away afterwards.
+    while (counter->value.load(std::memory_order_acquire) != 0) {
+        Job job;
+        if (get_job(&job)) {
+            execute_job(&job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void parallel_for(int count, int batch_size, Job_Proc proc, void *data) {
+    if (count <= 0) return;
+    if (batch_size < 1) batch_size = 1;
+
+    Job_Counter counter;
+
+    // The calling thread takes the first batch itself instead of waiting for a worker.
+    for (int begin = batch_size; begin < count; begin += batch_size) {
+        run_job(proc, data, &counter, begin, Min(begin + batch_size, count));
+    }
+
+    Temporary_Storage_Scope scope;
+    proc(data, 0, Min(batch_size, count));
+
+    wait_for_counter(&counter);
+}
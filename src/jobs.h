@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+
+//
+// Jobs are small tasks that run on a pool of worker threads. Every thread that runs jobs,
+// the main thread included, has its own deque: it pushes and pops at the bottom, and threads
+// that run out of work steal from the top of somebody else's.
+//
+// A Job_Counter counts jobs that haven't finished yet. wait_for_counter doesn't block, it runs
+// other jobs until the counter hits zero, so waiting on the main thread adds a core instead of
+// losing one. A job can also depend on a counter: run_job then holds it back, without taking up
+// a thread, until that counter hits zero.
+//
+// Jobs may only be submitted from the main thread or from inside other jobs. Whatever a job
+// allocates from temporary storage is released when it returns.
+//
+
+typedef void (*Job_Proc)(void *data, int begin, int end);
+
+struct Deferred_Job;
+
+struct Job_Counter {
+    // The number of unfinished jobs, plus JOB_COUNTER_LOCKED while waiting_jobs is being changed.
+    std::atomic <int> value { 0 };
+    Deferred_Job *waiting_jobs = nullptr; // Jobs that depend on this counter, see run_job.
+};
+
+const int JOB_COUNTER_LOCKED = 1 << 30;
+
+struct Job {
+    Job_Proc proc = nullptr;
+    void *data = nullptr;
+    int begin = 0;
+    int end = 0;
+    Job_Counter *counter = nullptr;
+};
+
+struct Deferred_Job {
+    Job job;
+    Deferred_Job *next = nullptr;
+};
+
+// num_workers < 0 means one per hardware thread, minus the main thread.
+void init_job_system(int num_workers = -1);
+void shutdown_job_system();
+
+int get_num_job_threads(); // Workers plus the main thread.
+
+// counter, if any, counts the job from now on, also while it is held back by depends_on. With
+// depends_on, the job only gets queued once depends_on hits zero (right away if it already
+// is). depends_on has to stay alive until then, the same as a counter that is waited on.
+void run_job(Job_Proc proc, void *data, Job_Counter *counter, int begin = 0, int end = 0, Job_Counter *depends_on = nullptr);
+void wait_for_counter(Job_Counter *counter);
+
+// Calls proc on batches of at most batch_size indices out of [0, count) and returns once all
+// of them have run.
+void parallel_for(int count, int batch_size, Job_Proc proc, void *data);
+
+template <typename Proc>
+inline void parallel_for(int count, int batch_size, Proc proc) {
+    Job_Proc trampoline = [](void *data, int begin, int end) { (*(Proc *)data)(begin, end); };
+    parallel_for(count, batch_size, trampoline, &proc);
+}
@@ -24,5 +24,3 @@ struct Keymap {
 
 bool load_keymap(Keymap *keymap, char *filepath);
 void set_keys_to_default(Keymap *keymap);
-
-void keymap_do_hotloading();
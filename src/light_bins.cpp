@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "light_bins.h"
+
+// The tiles of a light's bounding box that its circle actually touches, called once to count and once to fill.
+template <typename Proc>
+static void for_each_touched_tile(Light_Bins *bins, Vector2 center, float radius, Proc proc) {
+    int tx0 = Max((int)floorf((center.x - radius) / LIGHT_BIN_TILE_SIZE), 0);
+    int ty0 = Max((int)floorf((center.y - radius) / LIGHT_BIN_TILE_SIZE), 0);
+    int tx1 = Min((int)floorf((center.x + radius) / LIGHT_BIN_TILE_SIZE), bins->num_tiles_x - 1);
+    int ty1 = Min((int)floorf((center.y + radius) / LIGHT_BIN_TILE_SIZE), bins->num_tiles_y - 1);
+
+    float radius_squared = radius * radius;
+    for (int ty = ty0; ty <= ty1; ty++) {
+        float y0 = (float)(ty * LIGHT_BIN_TILE_SIZE);
+        float dy = Max(Max(y0 - center.y, center.y - (y0 + LIGHT_BIN_TILE_SIZE)), 0.0f);
+
+        for (int tx = tx0; tx <= tx1; tx++) {
+            float x0 = (float)(tx * LIGHT_BIN_TILE_SIZE);
+            float dx = Max(Max(x0 - center.x, center.x - (x0 + LIGHT_BIN_TILE_SIZE)), 0.0f);
+
+            if (dx*dx + dy*dy <= radius_squared) proc(ty * bins->num_tiles_x + tx);
+        }
+    }
+}
+
+void bin_lights(Light_Bins *bins, Rectangle2 view, int width, int height, Vector2 *centers, float *radii, int num_lights) {
+    bins->num_tiles_x = (width + LIGHT_BIN_TILE_SIZE - 1) / LIGHT_BIN_TILE_SIZE;
+    bins->num_tiles_y = (height + LIGHT_BIN_TILE_SIZE - 1) / LIGHT_BIN_TILE_SIZE;
+
+    int num_tiles = bins->num_tiles_x * bins->num_tiles_y;
+    bins->tile_counts.resize(num_tiles);
+    bins->tile_offsets.resize(num_tiles);
+    memset(bins->tile_counts.data, 0, num_tiles * sizeof(int));
+
+    bins->light_indices.clear();
+    bins->num_lit_tiles = 0;
+    bins->max_lights_in_a_tile = 0;
+
+    if (!num_tiles || view.width <= 0 || view.height <= 0) return;
+
+    // Everything below is in pixels, y up like the world.
+    Vector2 scale(width / view.width, height / view.height);
+    auto to_pixels = [&](int i, Vector2 *center, float *radius) {
+        *center = Vector2((centers[i].x - view.x) * scale.x, (centers[i].y - view.y) * scale.y);
+        *radius = radii[i] * Max(scale.x, scale.y);
+    };
+
+    for (int i = 0; i < num_lights; i++) {
+        Vector2 center;
+        float radius;
+        to_pixels(i, &center, &radius);
+        for_each_touched_tile(bins, center, radius, [&](int tile) { bins->tile_counts[tile] += 1; });
+    }
+
+    int offset = 0;
+    for (int tile = 0; tile < num_tiles; tile++) {
+        int count = bins->tile_counts[tile];
+        bins->tile_offsets[tile] = offset;
+        offset += count;
+
+        if (count) bins->num_lit_tiles += 1;
+        bins->max_lights_in_a_tile = Max(bins->max_lights_in_a_tile, count);
+    }
+
+    // Fill in light order, using the counts again as the write cursors.
+    bins->light_indices.resize(offset);
+    memset(bins->tile_counts.data, 0, num_tiles * sizeof(int));
+    for (int i = 0; i < num_lights; i++) {
+        Vector2 center;
+        float radius;
+        to_pixels(i, &center, &radius);
+        for_each_touched_tile(bins, center, radius, [&](int tile) {
+            bins->light_indices[bins->tile_offsets[tile] + bins->tile_counts[tile]] = i;
+            bins->tile_counts[tile] += 1;
+        });
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "array.h"
+#include "geometry.h"
+
+//
+// Splits the render target into LIGHT_BIN_TILE_SIZE pixel tiles and lists, for every tile, the
+// lights whose circles touch it. Nothing on the GPU reads the lists yet; they say how many
+// lights pile up on each part of the screen, which is what light cost scales with now that a
+// light only covers its own pixels.
+//
+// The lists are packed one after another: tile t's lights are
+// light_indices[tile_offsets[t]] .. light_indices[tile_offsets[t] + tile_counts[t] - 1].
+//
+
+const int LIGHT_BIN_TILE_SIZE = 32;
+
+struct Light_Bins {
+    int num_tiles_x = 0;
+    int num_tiles_y = 0;
+
+    Array <int> tile_counts;
+    Array <int> tile_offsets;
+    Array <int> light_indices;
+
+    int num_lit_tiles = 0;
+    int max_lights_in_a_tile = 0;
+};
+
+// view is the part of the world that covers the width by height pixel target. Light i is the
+// circle centers[i], radii[i], in world units.
+void bin_lights(Light_Bins *bins, Rectangle2 view, int width, int height, Vector2 *centers, float *radii, int num_lights);
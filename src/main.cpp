@@ -7,6 +7,8 @@
 #include "hud.h"
 #include "binary_file_stuff.h"
 #include "entity_manager.h"
+#include "tilemap_collision.h"
+#include "jobs.h"
 #include "entities.h"
 #include "animation.h"
 #include "main_menu.h"
@@ -24,42 +26,54 @@
 #include "shader_registry.h"
 #include "texture_registry.h"
 #include "animation_registry.h"
+#include "benchmarks.h"
 
 #include <stdio.h>
 
-#define Attach(var) globals.variable_service->attach(#var, &var)
+#define Attach(var) variable_service->attach(#var, &var)
 
 Game_Globals::Game_Globals() {
     variable_service = new Variable_Service();
     
     Attach(time_rate);
     Attach(zoom_speed);
+    Attach(max_ticks_per_frame);
 }
 
-const double GAMEPLAY_DT = 1.0 / 60.0; // @Hardcode
-
 static bool save_current_game_mode();
 
-static void keymap_do_hotloading() {
-    u64 modtime = globals.keymap->modtime;
-    get_file_last_write_time("data/Game.keymap", &modtime);
-    
-    if (modtime != globals.keymap->modtime) {
-        if (!load_keymap(globals.keymap, "data/Game.keymap")) {
-            set_keys_to_default(globals.keymap);
-            log_error("Failed to load the game keymap. Setting all keys to their defaults\n");
+// Only looks at files the OS told us about, so this costs nothing while nothing changes.
+static void do_hotloading() {
+    Array <char *> changed_files;
+    changed_files.use_temporary_storage = true;
+    os_get_file_changes(&changed_files);
+
+    for (int i = 0; i < changed_files.count; i++) {
+        char *path = changed_files[i];
+
+        // Editors often write a file more than once per save.
+        bool seen_already = false;
+        for (int j = 0; j < i; j++) {
+            if (strings_match(changed_files[j], path)) {
+                seen_already = true;
+                break;
+            }
         }
-        globals.keymap->modtime = modtime;
-    }
-}
+        if (seen_already) continue;
 
-static void vars_do_hotloading() {
-    u64 modtime = globals.variable_service->modtime;
-    get_file_last_write_time("data/All.vars", &modtime);
+        if (globals.shader_registry->hotload(path)) continue;
+        if (globals.texture_registry->hotload(path)) continue;
+        if (globals.animation_registry->hotload(path)) continue;
 
-    if (modtime != globals.variable_service->modtime) {
-        load_vars_file(globals.variable_service, "data/All.vars"); // @ReturnValueIgnored
-        globals.variable_service->modtime = modtime;
+        if (strings_match(path, "data/Game.keymap")) {
+            if (!load_keymap(globals.keymap, "data/Game.keymap")) {
+                set_keys_to_default(globals.keymap);
+                log_error("Failed to load the game keymap. Setting all keys to their defaults\n");
+            }
+        } else if (strings_match(path, "data/All.vars")) {
+            load_vars_file(globals.variable_service, "data/All.vars"); // @ReturnValueIgnored
+            get_file_last_write_time("data/All.vars", &globals.variable_service->modtime);
+        }
     }
 }
 
@@ -80,6 +94,20 @@ Global_Parameters global_parameters;
 
 static Key_Info key_infos[NUM_KEY_CODES];
 
+void begin_key_frame() {
+    for (int i = 0; i < NUM_KEY_CODES; i++) {
+        Key_Info *info = &key_infos[i];
+        info->changed = false;
+        info->was_down = info->is_down;
+    }
+}
+
+void set_key_state(int key_code, bool is_down) {
+    Key_Info *info = &key_infos[key_code];
+    info->changed = is_down != info->is_down;
+    info->is_down = is_down;
+}
+
 bool is_key_down(int key_code) {
     return key_infos[key_code].is_down;
 }
@@ -153,6 +181,42 @@ bool was_key_just_released(Key_Action action) {
 }
 
 static double accumulated_dt = 0.0;
+static double last_dropped_time_report = 0.0;
+
+void simulate_pending_ticks(double frame_dt) {
+    accumulated_dt += frame_dt;
+
+    int max_ticks = Max(globals.max_ticks_per_frame, 1);
+
+    int num_ticks = 0;
+    while (accumulated_dt >= GAMEPLAY_DT) {
+        if (num_ticks == max_ticks) {
+            // Catching up would take even longer next frame, so give the time up instead. The
+            // leftover fraction of a tick stays so that render_alpha is still right.
+            double dropped = accumulated_dt - fmod(accumulated_dt, GAMEPLAY_DT);
+            accumulated_dt -= dropped;
+
+            Time_Info *info = &globals.time_info;
+            info->num_frames_over_budget += 1;
+            info->dropped_time += dropped;
+
+            double now = get_time();
+            if (now - last_dropped_time_report >= 1.0) {
+                log("Simulation fell behind, dropped %.3fs of game time (%.3fs over %lld frames so far).\n",
+                    dropped, info->dropped_time, (long long)info->num_frames_over_budget);
+                last_dropped_time_report = now;
+            }
+            break;
+        }
+
+        simulate_game();
+        accumulated_dt -= GAMEPLAY_DT;
+        num_ticks += 1;
+    }
+
+    globals.time_info.ticks_this_frame = num_ticks;
+    globals.render_alpha = (float)(accumulated_dt / GAMEPLAY_DT);
+}
 
 static void respond_to_event_for_game(Event event) {
     auto manager = get_entity_manager();
@@ -174,74 +238,44 @@ static void update_single_guy(Guy *guy, Entity_Manager *manager, float dt) {
     
     float speed = 2.0f;    
     
+    Vector2 &velocity = guy->velocity();
+    Vector2 &position = guy->position();
+    Vector2 size = guy->size();
+    
     guy->max_velocity = Vector2(1.0f, 1.0f);
     
-    guy->velocity.x = move_toward(guy->velocity.x, 0.0f, fabsf(guy->velocity.x) * 2.0f);
-    guy->velocity.y = move_toward(guy->velocity.y, 0.0f, fabsf(guy->velocity.y) * 2.0f);
-    guy->velocity.x += move_dir.x * speed * dt;
-    guy->velocity.y += move_dir.y * speed * dt;
+    velocity.x = move_toward(velocity.x, 0.0f, fabsf(velocity.x) * 2.0f);
+    velocity.y = move_toward(velocity.y, 0.0f, fabsf(velocity.y) * 2.0f);
+    velocity.x += move_dir.x * speed * dt;
+    velocity.y += move_dir.y * speed * dt;
     
-    Clamp(guy->velocity.x, -guy->max_velocity.x, guy->max_velocity.x);
-    Clamp(guy->velocity.y, -guy->max_velocity.y, guy->max_velocity.y);
+    Clamp(velocity.x, -guy->max_velocity.x, guy->max_velocity.x);
+    Clamp(velocity.y, -guy->max_velocity.y, guy->max_velocity.y);
 
-    auto new_position = guy->position + guy->velocity;
+    auto new_position = position + velocity;
     
     c2AABB player_aabb;
     player_aabb.min = { new_position.x, new_position.y };
-    player_aabb.max = { new_position.x + guy->size.x * 0.9f, new_position.y + guy->size.y * 0.9f };
+    player_aabb.max = { new_position.x + size.x * 0.9f, new_position.y + size.y * 0.9f };
 
     Tilemap *tm = manager->tilemap;
-    if (tm) {
-        float xpos = tm->position.x;
-        float ypos = tm->position.y;
-        for (int y = 0; y < tm->height; y++) {
-            for (int x = 0; x < tm->width; x++) {
-                Tile tile = tm->tiles[y * tm->width + x];
-                if (tile.is_collidable) {
-                    c2AABB tile_aabb;
-                    tile_aabb.min = { xpos, ypos };
-                    tile_aabb.max = { xpos + 1.0f, ypos + 1.0f };
-                    
-                    bool has_collided = false;
-                    
-                    c2Manifold m;
-                    c2AABBtoAABBManifold(player_aabb, tile_aabb, &m);
-                    if (m.count) {
-                        Vector2 n(m.n.x, m.n.y);
-                        
-                        if (n.x != 0.0f) {
-                            guy->velocity.x = 0.0f;
-                        }
-
-                        if (n.y != 0.0f) {
-                            guy->velocity.y = 0.0f;
-                        }
-                    }
-                    
-                    if (has_collided) break;
-                }
-                xpos += 1.0f;
-            }
-            xpos = tm->position.x;
-            ypos += 1.0f;
-        }
-    }
+    if (tm) resolve_tile_collisions(tm, player_aabb, &velocity);
     
-    guy->position += guy->velocity;// * dt;
+    position += velocity;// * dt;
 
     Guy_State state = guy->current_state;
     Guy_Orientation orientation = guy->orientation;
     
-    if (guy->velocity.x != 0.0f || guy->velocity.y != 0.0f) {
+    if (velocity.x != 0.0f || velocity.y != 0.0f) {
         state = GUY_STATE_MOVING;
 
-        bool moving_diagonally = guy->velocity.x && guy->velocity.y;
+        bool moving_diagonally = velocity.x && velocity.y;
         if (!moving_diagonally) {
-            if (guy->velocity.x > 0.0f) orientation = GUY_LOOKING_RIGHT;
-            else if (guy->velocity.x < 0.0f) orientation = GUY_LOOKING_LEFT;
+            if (velocity.x > 0.0f) orientation = GUY_LOOKING_RIGHT;
+            else if (velocity.x < 0.0f) orientation = GUY_LOOKING_LEFT;
             
-            if (guy->velocity.y > 0.0f) orientation = GUY_LOOKING_UP;
-            else if (guy->velocity.y < 0.0f) orientation = GUY_LOOKING_DOWN;
+            if (velocity.y > 0.0f) orientation = GUY_LOOKING_UP;
+            else if (velocity.y < 0.0f) orientation = GUY_LOOKING_DOWN;
         }
     } else {
         state = GUY_STATE_IDLE;
@@ -250,17 +284,18 @@ static void update_single_guy(Guy *guy, Entity_Manager *manager, float dt) {
     guy->set_state(state);
     guy->set_orientation(orientation);
 
-    auto light_source_e = manager->get_entity_by_id(guy->light_source_id);
+    auto light_source_e = manager->get_entity(guy->light_source);
     if (light_source_e) {
         auto light_source = (Light_Source *)light_source_e;
-        light_source->position = guy->position + (0.5f * guy->size);
+        light_source->position() = position + (0.5f * size);
     }
 }
 
-static void simulate_game() {
+void simulate_game() {
     float dt = get_gameplay_dt();
     
     auto manager = get_entity_manager();
+    manager->save_previous_positions();
     manager->camera->update(dt);
     
     Guy *guy = manager->get_active_hero();
@@ -268,8 +303,10 @@ static void simulate_game() {
         update_single_guy(guy, manager, dt);
     }
     
-    for (Thumbleweed *tw : manager->by_type._Thumbleweed) tw->update_current_animation(dt);
-    for (Guy *guy : manager->by_type._Guy) guy->update_current_animation(dt);
+    update_entity_animations(manager, dt);
+
+    manager->destroy_scheduled_entities();
+    manager->update_spatial_grid();
 }
 
 static void respond_to_input() {
@@ -294,8 +331,6 @@ static void update_time(float dt_max) {
     double delta = now - globals.last_time;
     float dilated_dt = (float)(delta * globals.time_rate);
     
-    accumulated_dt += delta;
-    
     float clamped_dilated_dt = dilated_dt;
     if (clamped_dilated_dt > dt_max) clamped_dilated_dt = dt_max;
 
@@ -311,7 +346,7 @@ static void update_time(float dt_max) {
     globals.last_time = now;
 }
 
-static void init_shaders() {
+void init_shaders() {
     globals.shader_color = globals.shader_registry->get("color");
     globals.shader_texture = globals.shader_registry->get("texture");
     globals.shader_text = globals.shader_registry->get("text");
@@ -323,7 +358,7 @@ static void init_shaders() {
     globals.shader_alpha_clear = globals.shader_registry->get("alpha_clear");
 }
 
-static void init_game() {
+void init_game() {
     globals.keymap = new Keymap();
     if (!load_keymap(globals.keymap, "data/Game.keymap")) {
         set_keys_to_default(globals.keymap);
@@ -349,13 +384,9 @@ static void do_one_frame() {
 
         init_menu_fonts();
     }
-    globals.window_resizes.count = 0;
+    globals.window_resizes.clear();
 
-    for (int i = 0; i < ArrayCount(key_infos); i++) {
-        Key_Info *info = &key_infos[i];
-        info->changed = false;
-        info->was_down = info->is_down;
-    }
+    begin_key_frame();
     update_window_events();
     for (Event event : globals.events_this_frame) {
         switch (event.type) {
@@ -364,9 +395,7 @@ static void do_one_frame() {
                 break;
 
             case EVENT_TYPE_KEYBOARD: {
-                Key_Info *info = &key_infos[event.key_code];
-                info->changed = event.key_pressed != info->is_down;
-                info->is_down = event.key_pressed;
+                set_key_state(event.key_code, event.key_pressed);
 
                 if (event.alt_pressed && event.key_pressed) {
                     if (event.key_code == KEY_F4) {
@@ -430,12 +459,11 @@ static void do_one_frame() {
         }
         globals.draw_cursor = false;
         
-        while (accumulated_dt >= GAMEPLAY_DT) {
-            simulate_game();
-            accumulated_dt -= GAMEPLAY_DT;
-        }
+        simulate_pending_ticks(globals.time_info.ui_dt);
     } else {
         accumulated_dt = 0.0;
+        globals.render_alpha = 1.0f;
+        get_entity_manager()->save_previous_positions();
         os_unconstrain_mouse();
         globals.draw_cursor = false;
         
@@ -469,11 +497,7 @@ static void do_one_frame() {
     
     swap_buffers();
     
-    globals.shader_registry->do_hotloading();
-    globals.texture_registry->do_hotloading();
-    globals.animation_registry->do_hotloading();
-    keymap_do_hotloading();
-    vars_do_hotloading();
+    do_hotloading();
 }
 
 static void main_loop() {
@@ -482,10 +506,23 @@ static void main_loop() {
     }
 }
 
+#ifndef BUILD_HEADLESS // The headless runner has its own main, see headless.cpp.
 int main(int argc, char **argv) {
     init_temporary_storage(40000);
     init_colors_and_utf8();
 
+    // main -bench name runs one of the microbenchmarks in benchmarks.cpp instead of the game.
+    if ((argc == 3) && strings_match(argv[1], "-bench")) {
+        Benchmark *benchmark = find_benchmark(argv[2]);
+        if (!benchmark) {
+            fprintf(stderr, "Unknown benchmark '%s'.\n", argv[2]);
+            return 1;
+        }
+        return benchmark->proc() ? 0 : 1;
+    }
+
+    init_job_system();
+
     {
         char *path = get_path_of_running_executable();
         defer { delete [] path; };
@@ -496,6 +533,8 @@ int main(int argc, char **argv) {
         setcwd(path);
     }
 
+    os_watch_directory("data");
+
     globals.last_time = get_time();
 
     globals.display_width = 1600;
@@ -506,6 +545,9 @@ int main(int argc, char **argv) {
     globals.shader_registry = new Shader_Registry();
     globals.texture_registry = new Texture_Registry();
     globals.animation_registry = new Animation_Registry();
+
+    // Made by atlas_packer. Without it every image is a texture of its own, which works, just slower.
+    globals.texture_registry->load_atlas("textures");
     
     init_shaders();
     
@@ -514,9 +556,13 @@ int main(int argc, char **argv) {
     init_game();
     
     main_loop();
+
+    shutdown_render();
+    shutdown_job_system();
     
     return 0;
 }
+#endif
 
 float get_gameplay_dt() {
     return (float)((double)GAMEPLAY_DT * globals.time_rate);
@@ -563,6 +609,14 @@ static void load_tree(Tree *tree, FILE *file) {
     
 }
 
+// Savegames refer to other entities by id, handles only get made once everything is loaded.
+static void resolve_entity_references(Entity_Manager *manager) {
+    for (Guy *guy : manager->by_type._Guy) {
+        Entity *light_source = manager->get_entity_by_id(guy->light_source_id);
+        if (light_source) guy->light_source = light_source->handle;
+    }
+}
+
 Game_Mode_Info *load_game_mode(Game_Mode game_mode) {
     char *savegame_name = get_savegame_name_for_game_mode(game_mode);
     if (!savegame_name) return NULL;
@@ -617,36 +671,41 @@ Game_Mode_Info *load_game_mode(Game_Mode game_mode) {
 
         if (strings_match(entity_type_str, "Guy")) {
             Guy *guy = manager->make_guy(id);
-            guy->position = position;
+            guy->position() = position;
             load_guy(guy, file);
         } else if (strings_match(entity_type_str, "Enemy")) {
             Enemy *enemy = manager->make_enemy(id);
-            enemy->position = position;
+            enemy->position() = position;
             load_enemy(enemy, file);
         } else if (strings_match(entity_type_str, "Thumbleweed")) {
             Thumbleweed *tw = manager->make_thumbleweed(id);
-            tw->position = position;
+            tw->position() = position;
             load_thumbleweed(tw, file);
         } else if (strings_match(entity_type_str, "Light_Source")) {
             Light_Source *ls = manager->make_light_source(id);
-            ls->position = position;
+            ls->position() = position;
             load_light_source(ls, file);
         } else if (strings_match(entity_type_str, "Tree")) {
             Tree *tree = manager->make_tree(id);
-            tree->position = position;
+            tree->position() = position;
             load_tree(tree, file);
         }
     }
 
+    resolve_entity_references(manager);
+
     Tilemap *tilemap = manager->make_tilemap();
     load_tilemap(tilemap, tilemap_name);
-    tilemap->position = Vector2(-8.0f, -4.5f);
+    tilemap->position() = Vector2(-8.0f, -4.5f);
     
     Camera *camera = new Camera();
     camera->position = Vector2(0, 0);
     camera->zoom_t_target = 1.0f;
     camera->zoom_t = 1.0f;
     manager->camera = camera;
+
+    // So that the first frame doesn't draw everything on its way from the origin.
+    manager->save_previous_positions();
     
     return info;
 }
@@ -670,7 +729,7 @@ static void save_entity(FILE *file, Entity *e) {
     fprintf(file, "type %s\n", entity_type_string(e->type));
     fprintf(file, "id %d\n", e->id);
 
-    fprintf(file, "position (%f, %f)\n", e->position.x, e->position.y);
+    fprintf(file, "position (%f, %f)\n", e->position().x, e->position().y);
     //fprintf(file, "size (%f, %f)\n", e->size.x, e->size.y);
 }
 
@@ -801,35 +860,38 @@ static void init_overworld(Game_Mode_Info *info) {
     manager->camera = camera;
     
     Guy *guy = manager->make_guy();
-    guy->position = Vector2(0.0f, 0.5f);
-    guy->size = Vector2(1.0f, 1.0f);
+    guy->position() = Vector2(0.0f, 0.5f);
+    guy->size() = Vector2(1.0f, 1.0f);
     manager->set_active_hero(guy);
     
     Tilemap *tilemap = manager->make_tilemap();
     load_tilemap(tilemap, "test");
-    tilemap->position = Vector2(-8.0f, -4.5f);
+    tilemap->position() = Vector2(-8.0f, -4.5f);
 
     Enemy *enemy = manager->make_enemy();
-    enemy->position = Vector2(-7.0f, -3.5f);
+    enemy->position() = Vector2(-7.0f, -3.5f);
     enemy->texture = globals.texture_registry->get("pachi_demon_knight_front");
 
     Thumbleweed *thumbleweed = manager->make_thumbleweed();
-    thumbleweed->position = Vector2(-1.0f, -0.5f);
+    thumbleweed->position() = Vector2(-1.0f, -0.5f);
 
     // TEMPORARY
-    thumbleweed->current_animation = thumbleweed->attack_animation;
+    thumbleweed->set_animation(thumbleweed->attack_animation);
 
     Light_Source *source = manager->make_light_source();
-    source->position = guy->position;
+    source->position() = guy->position();
     source->radius = 1.0f;
     source->color = Vector3(1.0f, 0.5f, 0.2f);
     guy->light_source_id = source->id;
+    guy->light_source = source->handle;
 
     Tree *tree0 = manager->make_tree();
-    tree0->size.y = 2.0f;
-    tree0->size.x = tree0->size.y * 0.833333f;
-    tree0->position.x = -6.0f - (tree0->size.x * 0.5f);
-    tree0->position.y = +1.25f + (tree0->size.y * 0.5f);
+    tree0->size().y = 2.0f;
+    tree0->size().x = tree0->size().y * 0.833333f;
+    tree0->position().x = -6.0f - (tree0->size().x * 0.5f);
+    tree0->position().y = +1.25f + (tree0->size().y * 0.5f);
+
+    manager->save_previous_positions();
 }
 
 Entity_Manager *get_entity_manager() {
@@ -15,6 +15,13 @@ void setcwd(char *path);
 
 bool get_file_last_write_time(char *filepath, u64 *modtime);
 
+// Directories are watched along with everything under them. os_get_file_changes reports the
+// files that were written or moved into place since the last call, as paths that start with
+// the watched directory, e.g. "data/textures/tree.png". The paths are in temporary storage and
+// the same file may show up more than once.
+bool os_watch_directory(char *dir);
+void os_get_file_changes(Array <char *> *changed_files);
+
 double get_time();
 
 void os_show_cursor(bool should_show);
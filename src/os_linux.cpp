@@ -0,0 +1,185 @@
+#include "pch.h"
+
+#ifdef __linux__
+
+//
+// There is no window on Linux yet: create_window returns NULL and no events ever come in.
+// Files, directories, time and file change notifications (through inotify) all work.
+//
+
+#include "os.h"
+#include "game.h"
+#include "hash_table.h"
+
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/inotify.h>
+
+static const u32 WATCH_EVENT_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+
+static int inotify_fd = -1;
+static Hash_Table <int, char *> watched_directories; // Watch descriptor to directory path.
+
+Window_Type create_window(int, int, char *) {
+    return NULL;
+}
+
+void update_window_events() {
+    globals.events_this_frame.clear();
+}
+
+void window_toggle_fullscreen(Window_Type) {
+}
+
+bool file_exists(char *fullpath) {
+    return access(fullpath, F_OK) == 0;
+}
+
+void init_colors_and_utf8() {
+}
+
+char *get_path_of_running_executable() {
+    char *result = new char[PATH_MAX + 1];
+    ssize_t length = readlink("/proc/self/exe", result, PATH_MAX);
+    if (length < 0) length = 0;
+    result[length] = 0;
+    return result;
+}
+
+void setcwd(char *path) {
+    if (chdir(path) != 0) {
+        log_error("Failed to change the working directory to '%s'.\n", path);
+    }
+}
+
+bool get_file_last_write_time(char *filepath, u64 *modtime) {
+    struct stat st;
+    if (stat(filepath, &st) != 0) return false;
+
+    if (modtime) *modtime = (u64)st.st_mtim.tv_sec * 1000000000ull + (u64)st.st_mtim.tv_nsec;
+
+    return true;
+}
+
+// inotify watches aren't recursive, so every directory under dir gets its own watch.
+static bool add_directory_watch(char *dir) {
+    int wd = inotify_add_watch(inotify_fd, dir, WATCH_EVENT_MASK);
+    if (wd < 0) {
+        log_error("Failed to watch directory '%s' for changes: %s.\n", dir, strerror(errno));
+        return false;
+    }
+
+    char **existing = watched_directories.find(wd);
+    if (existing) delete [] *existing;
+    watched_directories.add(wd, copy_string(dir));
+
+    DIR *d = opendir(dir);
+    if (!d) return true;
+    defer { closedir(d); };
+
+    while (struct dirent *entry = readdir(d)) {
+        if (strings_match(entry->d_name, ".") || strings_match(entry->d_name, "..")) continue;
+
+        Temporary_Storage_Scope scope;
+        char *path = tprint("%s/%s", dir, entry->d_name);
+
+        bool is_directory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) is_directory = os_directory_exists(path);
+
+        if (is_directory) add_directory_watch(path);
+    }
+
+    return true;
+}
+
+bool os_watch_directory(char *dir) {
+    if (inotify_fd < 0) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            log_error("inotify_init1 failed: %s.\n", strerror(errno));
+            return false;
+        }
+    }
+
+    return add_directory_watch(dir);
+}
+
+void os_get_file_changes(Array <char *> *changed_files) {
+    if (inotify_fd < 0) return;
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    while (true) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) break; // EAGAIN when there is nothing left to read.
+
+        for (char *at = buffer; at < buffer + length; ) {
+            auto event = (struct inotify_event *)at;
+            at += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                log_error("Too many file changes at once, some of them were missed.\n");
+                continue;
+            }
+
+            char **dir = watched_directories.find(event->wd);
+            if (!dir) continue;
+
+            if (event->mask & IN_IGNORED) {
+                delete [] *dir;
+                watched_directories.remove(event->wd);
+                continue;
+            }
+
+            if (!event->len) continue;
+            char *path = tprint("%s/%s", *dir, event->name);
+
+            if (event->mask & IN_ISDIR) {
+                // A new directory, or one moved in from somewhere we don't watch.
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) add_directory_watch(path);
+                continue;
+            }
+
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) changed_files->add(path);
+        }
+    }
+}
+
+double get_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+void os_show_cursor(bool) {
+}
+
+void os_unconstrain_mouse() {
+}
+
+void os_constrain_mouse(Window_Type) {
+}
+
+void os_get_mouse_pointer_position(int *x, int *y, Window_Type, bool) {
+    if (x) *x = 0;
+    if (y) *y = 0;
+}
+
+bool os_directory_exists(char *dir) {
+    struct stat st;
+    if (stat(dir, &st) != 0) return false;
+    return S_ISDIR(st.st_mode);
+}
+
+bool os_make_directory_if_not_exist(char *dir) {
+    if (os_directory_exists(dir)) return false;
+
+    return mkdir(dir, 0755) == 0;
+}
+
+#endif
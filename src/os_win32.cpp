@@ -12,6 +12,15 @@ static bool window_class_initted = false;
 static wchar_t *WINDOW_CLASS_NAME = L"ThingWin32WindowClass";
 static Hash_Table <HWND, WINDOWPLACEMENT> window_placements;
 
+struct Directory_Watch {
+    char *path = NULL;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped = {};
+    alignas(DWORD) u8 buffer[16 * 1024];
+};
+
+static Array <Directory_Watch *> directory_watches;
+
 static Key_Code vk_code_to_key_code(u32 vk_code) {
     if (vk_code >= 48 && vk_code <= 90) return (Key_Code) vk_code;
 
@@ -328,7 +337,7 @@ Window_Type create_window(int width, int height, char *title) {
 }
 
 void update_window_events() {
-    globals.events_this_frame.count = 0;
+    globals.events_this_frame.clear();
     MSG msg;
     while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
         TranslateMessage(&msg);
@@ -426,6 +435,83 @@ bool get_file_last_write_time(char *filepath, u64 *modtime) {
     return true;
 }
 
+static bool issue_directory_read(Directory_Watch *watch) {
+    DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+    BOOL result = ReadDirectoryChangesW(watch->handle, watch->buffer, sizeof(watch->buffer), TRUE,
+                                        filter, NULL, &watch->overlapped, NULL);
+    return result != 0;
+}
+
+bool os_watch_directory(char *dir) {
+    wchar_t *wide_dir = utf8_to_wstring(dir);
+    for (wchar_t *at = wide_dir; *at; at++) {
+        if (*at == L'/') {
+            *at = L'\\';
+        }
+    }
+
+    HANDLE handle = CreateFileW(wide_dir, FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        log_error("Failed to open directory '%s' to watch it for changes.\n", dir);
+        return false;
+    }
+
+    Directory_Watch *watch = new Directory_Watch();
+    watch->path = copy_string(dir);
+    watch->handle = handle;
+    watch->overlapped.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    if (!issue_directory_read(watch)) {
+        log_error("ReadDirectoryChangesW failed for directory '%s'.\n", dir);
+        CloseHandle(watch->overlapped.hEvent);
+        CloseHandle(handle);
+        delete [] watch->path;
+        delete watch;
+        return false;
+    }
+
+    directory_watches.add(watch);
+    return true;
+}
+
+void os_get_file_changes(Array <char *> *changed_files) {
+    for (Directory_Watch *watch : directory_watches) {
+        DWORD num_bytes = 0;
+        if (!GetOverlappedResult(watch->handle, &watch->overlapped, &num_bytes, FALSE)) continue; // Still waiting for something to happen.
+
+        if (!num_bytes) {
+            log_error("Too many file changes at once in '%s', some of them were missed.\n", watch->path);
+        }
+
+        u8 *at = watch->buffer;
+        while (num_bytes) {
+            auto info = (FILE_NOTIFY_INFORMATION *)at;
+
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+                info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                // FileName is relative to the watched directory and isn't zero-terminated.
+                int num_chars = info->FileNameLength / sizeof(wchar_t);
+                wchar_t *wide_name = (wchar_t *)talloc((num_chars + 1) * sizeof(wchar_t));
+                memcpy(wide_name, info->FileName, info->FileNameLength);
+                wide_name[num_chars] = 0;
+
+                char *name = wstring_to_utf8(wide_name);
+                if (name) {
+                    replace_backslash_with_forwardslash(name);
+                    changed_files->add(tprint("%s/%s", watch->path, name));
+                }
+            }
+
+            if (!info->NextEntryOffset) break;
+            at += info->NextEntryOffset;
+        }
+
+        issue_directory_read(watch);
+    }
+}
+
 double get_time() {
     s64 perf_freq;
     QueryPerformanceFrequency((LARGE_INTEGER * )&perf_freq);
@@ -495,8 +581,7 @@ void os_get_mouse_pointer_position(int *x, int *y, Window_Type window_handle, bo
 }
 
 bool os_directory_exists(char *dir) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     wchar_t *wide_filepath = utf8_to_wstring(dir);
     for (wchar_t *at = wide_filepath; *at; at++) {
@@ -514,8 +599,7 @@ bool os_directory_exists(char *dir) {
 bool os_make_directory_if_not_exist(char *dir) {
     if (os_directory_exists(dir)) return false;
 
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     wchar_t *wide_filepath = utf8_to_wstring(dir);
     for (wchar_t *at = wide_filepath; *at; at++) {
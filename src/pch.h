@@ -10,6 +10,8 @@
 
 #ifdef _WIN32
 typedef struct HWND__ *Window_Type;
+#else
+typedef void *Window_Type;
 #endif
 
 #ifdef _WIN32
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "array.h"
+
+//
+// Fixed-size items carved out of slabs that are never moved or freed while the pool is
+// alive, so pointers to items stay valid until the item itself gets released. Released
+// items go on a free list and get handed out again before a new slab is made.
+//
+
+template <typename T>
+struct Pool {
+    static const int ITEMS_PER_SLAB = 256;
+
+    Array <T *> slabs;
+    Array <T *> free_items;
+    int count = 0;
+
+    ~Pool();
+
+    T *get();
+    void release(T *item);
+    void release_empty_slabs();
+
+private:
+    void add_slab();
+};
+
+template <typename T>
+inline Pool <T>::~Pool() {
+    // Items still alive at this point are leaked on purpose, whoever owns them is being torn down.
+    for (T *slab : slabs) free(slab);
+}
+
+template <typename T>
+inline void Pool <T>::add_slab() {
+    T *slab = (T *)malloc(ITEMS_PER_SLAB * sizeof(T));
+    slabs.add(slab);
+
+    // Backwards, so that items get handed out in address order.
+    free_items.reserve(free_items.count + ITEMS_PER_SLAB);
+    for (int i = ITEMS_PER_SLAB-1; i >= 0; i--) {
+        free_items.add(slab + i);
+    }
+}
+
+template <typename T>
+inline T *Pool <T>::get() {
+    if (!free_items.count) add_slab();
+
+    T *item = free_items[free_items.count-1];
+    free_items.count -= 1;
+    count += 1;
+
+    return new (item) T();
+}
+
+template <typename T>
+inline void Pool <T>::release(T *item) {
+    item->~T();
+    free_items.add(item);
+    count -= 1;
+}
+
+inline int pool_compare_slabs(const void *a, const void *b) {
+    uintptr_t pa = *(uintptr_t *)a;
+    uintptr_t pb = *(uintptr_t *)b;
+    if (pa < pb) return -1;
+    if (pa > pb) return 1;
+    return 0;
+}
+
+// slabs must be sorted by address.
+template <typename T>
+inline int pool_find_slab(Array <T *> *slabs, T *item) {
+    int lo = 0;
+    int hi = slabs->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if ((uintptr_t)(*slabs)[mid] <= (uintptr_t)item) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// Frees slabs without live items. One empty slab is kept so that a pool whose count hovers
+// around a slab boundary doesn't keep making and freeing them.
+template <typename T>
+inline void Pool <T>::release_empty_slabs() {
+    if (free_items.count < 2 * ITEMS_PER_SLAB) return;
+
+    Temporary_Storage_Scope scope;
+
+    qsort(slabs.data, slabs.count, sizeof(T *), pool_compare_slabs);
+
+    Array <int> num_free;
+    num_free.use_temporary_storage = true;
+    num_free.resize(slabs.count);
+    for (int &n : num_free) n = 0;
+
+    for (T *item : free_items) num_free[pool_find_slab(&slabs, item)] += 1;
+
+    // Everything with ITEMS_PER_SLAB free items goes, except the first one of them.
+    for (int &n : num_free) {
+        if (n == ITEMS_PER_SLAB) {
+            n = -1;
+            break;
+        }
+    }
+
+    int num_kept_items = 0;
+    for (T *item : free_items) {
+        if (num_free[pool_find_slab(&slabs, item)] == ITEMS_PER_SLAB) continue;
+        free_items[num_kept_items++] = item;
+    }
+    free_items.resize(num_kept_items);
+
+    int num_kept_slabs = 0;
+    for (int i = 0; i < slabs.count; i++) {
+        if (num_free[i] == ITEMS_PER_SLAB) {
+            free(slabs[i]);
+            continue;
+        }
+        slabs[num_kept_slabs++] = slabs[i];
+    }
+    slabs.resize(num_kept_slabs);
+
+    free_items.shrink();
+    slabs.shrink();
+}
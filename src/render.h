@@ -6,22 +6,58 @@
 
 struct Color_Target {
     Texture *texture;
+#ifdef RENDER_D3D11
     ID3D11RenderTargetView *rtv;
+#endif
 };
 
 struct Depth_Target {
     Texture *texture;
+#ifdef RENDER_D3D11
     ID3D11DepthStencilView *dsv;
+#endif
 };
 
+// Vertices that live on the GPU and don't change, drawn with whatever shader and textures are set.
+// RENDER_VERTEX_SPRITE buffers are quads, drawn with the shared quad index buffer.
+struct Vertex_Buffer {
+    Render_Vertex_Type vertex_type = RENDER_VERTEX_XCUN;
+    int num_vertices = 0;
+#ifdef RENDER_D3D11
+    ID3D11Buffer *vbo = NULL;
+#endif
+};
+
+// Counted while recording a frame (see render_commands.cpp), swap_buffers starts them over.
+struct Render_Stats {
+    int num_draw_calls = 0;
+    s64 num_vertices = 0;
+    s64 num_bytes_uploaded = 0; // Immediate vertices copied to the GPU.
+    int num_commands = 0;
+    s64 num_command_bytes = 0; // The commands and everything that got copied into the frame for them.
+};
+
+extern Render_Stats render_stats;
+
+// The immediate vertices get flushed when there are this many, whichever backend draws them.
+const int MAX_IMMEDIATE_VERTICES = 6 * 4096;
+const int MAX_IMMEDIATE_SPRITE_QUADS = 16384; // 65536 vertices, as many as 16-bit indices reach.
+const int MAX_SPRITE_INSTANCES_PER_DRAW = 16384;
+
 extern Color_Target *the_back_buffer;
 
 extern Color_Target *the_offscreen_buffer;
 extern Color_Target *the_lightmap_buffer;
 
+// Drawing gets recorded and replayed on a render thread that init_render starts, see
+// render_commands.cpp. swap_buffers hands it the frame.
 void init_render(Window_Type window_handle, int width, int height, bool vsync);
+void shutdown_render();
 void swap_buffers();
 
+// Returns once the render thread has replayed everything recorded so far, and is idle.
+void wait_for_render_thread();
+
 Color_Target *create_color_target(int width, int height);
 void release_color_target(Color_Target *ct);
 
@@ -34,6 +70,10 @@ void clear_depth_target(Depth_Target *dt, float z);
 void set_viewport(int x, int y, int width, int height);
 void set_scissor(int x, int y, int width, int height);
 
+Vertex_Buffer *create_vertex_buffer(Render_Vertex_Type vertex_type, void *vertices, int num_vertices);
+void release_vertex_buffer(Vertex_Buffer *vertex_buffer); // Once the render thread is done with what was recorded before it.
+void draw_vertex_buffer(Vertex_Buffer *vertex_buffer); // Flushes the immediate vertices first, to keep the order.
+
 void immediate_begin();
 void immediate_flush();
 void immediate_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector4 color);
@@ -43,4 +83,15 @@ void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector2 uv0,
 void immediate_quad(float x0, float y0, float x1, float y1, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color);
 void immediate_triangle(Vector2 p0, Vector2 p1, Vector2 p2, Vector4 color);
 
+// For shaders with VertexType = "Sprite". p0 and uv0 are the bottom left, p2 and uv1 the top right.
+void immediate_sprite_quad(Vector2 p0, Vector2 p2, Vector2 uv0, Vector2 uv1, u32 color);
+
+// For shaders with VertexType = "Sprite_Instance": one instanced draw of a unit quad per
+// MAX_SPRITE_INSTANCES_PER_DRAW instances. Flushes the immediate buffer first.
+void draw_sprite_instances(Sprite_Instance *instances, int num_instances);
+
+// The same, but returns room for the instances in the frame being recorded, to fill in before
+// anything else gets recorded. Saves copying them when they have to be put together anyway.
+Sprite_Instance *draw_sprite_instances(int num_instances);
+
 Shader *set_shader(Shader *shader);
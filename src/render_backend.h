@@ -0,0 +1,60 @@
+#pragma once
+
+#include "render.h"
+
+//
+// What render_d3d11.cpp and render_null.cpp implement. Nothing but render_commands.cpp calls
+// these: the rest of the game goes through render.h, which records commands that the render
+// thread replays into these functions (see render_commands.cpp).
+//
+// The ones that draw or change state only run on the render thread. The ones that create or
+// load things run on the game thread, the ones that load into something that already exists or
+// release a target only while the render thread is idle.
+//
+
+void backend_init(Window_Type window_handle, int width, int height, bool vsync);
+void backend_present();
+void backend_resize(int width, int height);
+
+Color_Target *backend_create_color_target(int width, int height);
+void backend_release_color_target(Color_Target *ct);
+
+void backend_set_render_targets(Color_Target *ct, Depth_Target *dt);
+void backend_clear_color_target(Color_Target *ct, float r, float g, float b, float a, Rectangle2i *rect);
+void backend_clear_depth_target(Depth_Target *dt, float z);
+
+void backend_set_viewport(int x, int y, int width, int height);
+void backend_set_scissor(int x, int y, int width, int height);
+
+void backend_set_shader(Shader *shader);
+void backend_set_global_parameters(Global_Parameters *parameters);
+void backend_set_texture(int slot, Texture *texture);
+void backend_update_texture(Texture *texture, int x, int y, int width, int height, u8 *data);
+
+Vertex_Buffer *backend_create_vertex_buffer(Render_Vertex_Type vertex_type, void *vertices, int num_vertices);
+void backend_release_vertex_buffer(Vertex_Buffer *vertex_buffer);
+void backend_draw_vertex_buffer(Vertex_Buffer *vertex_buffer);
+
+// One draw of vertices that get copied to the GPU: at most MAX_IMMEDIATE_VERTICES of
+// RENDER_VERTEX_XCUN, or MAX_IMMEDIATE_SPRITE_QUADS quads of RENDER_VERTEX_SPRITE.
+void backend_draw_immediate(Render_Vertex_Type vertex_type, void *vertices, int num_vertices);
+
+// At most MAX_SPRITE_INSTANCES_PER_DRAW.
+void backend_draw_sprite_instances(Sprite_Instance *instances, int num_instances);
+
+bool backend_load_shader(Shader *shader, char *filepath);
+bool backend_load_texture_from_bitmap(Texture *texture, Bitmap *bitmap);
+
+#ifdef RENDER_NULL
+// What the null backend replayed, counted on the render thread, so that the headless runner can
+// check it against render_stats.
+struct Null_Replay_Counts {
+    s64 num_frames = 0;
+    s64 num_state_changes = 0; // Targets, clears, viewports, scissors, shaders, parameters and textures.
+    s64 num_draw_calls = 0;
+    s64 num_vertices = 0;
+    s64 num_bytes_uploaded = 0; // Immediate vertices, sprite instances and texture updates.
+};
+
+extern Null_Replay_Counts null_replay_counts; // Only read it while the render thread is idle, see wait_for_render_thread.
+#endif
@@ -0,0 +1,508 @@
+#include "pch.h"
+#include "render_backend.h"
+#include "game.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// The render.h functions don't draw anything themselves. They record commands into a frame,
+// and swap_buffers hands the frame to the render thread, which replays it into the backend
+// (render_backend.h) while the game thread goes on to the next one. There are
+// NUM_RECORDED_FRAMES frames, so the game thread only waits when it gets that far ahead.
+//
+// Immediate vertices are generated straight into the frame and flushed at the same points as
+// they were when the backend drew them right away, so render_stats, which is counted here
+// while recording, is what the backend draws.
+//
+// Whatever a command points at has to stay alive until the frame is replayed: textures,
+// shaders and color targets do, vertex buffers get released by a command of their own, and
+// everything else (vertices, instances, texture data, global parameters) is copied into the
+// frame. Loading into a shader or texture, resizing and releasing color targets wait for the
+// render thread to replay everything recorded so far and then call the backend directly.
+//
+
+const int NUM_RECORDED_FRAMES = 2;
+
+enum Render_Command_Type : u32 {
+    RENDER_COMMAND_SET_RENDER_TARGETS,
+    RENDER_COMMAND_CLEAR_COLOR_TARGET,
+    RENDER_COMMAND_CLEAR_DEPTH_TARGET,
+    RENDER_COMMAND_SET_VIEWPORT,
+    RENDER_COMMAND_SET_SCISSOR,
+    RENDER_COMMAND_SET_SHADER,
+    RENDER_COMMAND_SET_GLOBAL_PARAMETERS,
+    RENDER_COMMAND_SET_TEXTURE,
+    RENDER_COMMAND_UPDATE_TEXTURE,
+    RENDER_COMMAND_DRAW_IMMEDIATE,
+    RENDER_COMMAND_DRAW_VERTEX_BUFFER,
+    RENDER_COMMAND_DRAW_SPRITE_INSTANCES,
+    RENDER_COMMAND_RELEASE_VERTEX_BUFFER,
+    RENDER_COMMAND_PRESENT,
+};
+
+// Offsets are into Recorded_Frame::data, except for DRAW_IMMEDIATE's, which is into vertices.
+struct Render_Command {
+    Render_Command_Type type;
+
+    union {
+        struct { Color_Target *ct; Depth_Target *dt; } set_render_targets;
+        struct { Color_Target *ct; float color[4]; bool has_rect; Rectangle2i rect; } clear_color_target;
+        struct { Depth_Target *dt; float z; } clear_depth_target;
+        struct { int x, y, width, height; } rect; // SET_VIEWPORT and SET_SCISSOR.
+        struct { Shader *shader; } set_shader;
+        struct { int offset; } set_global_parameters;
+        struct { int slot; Texture *texture; } set_texture;
+        struct { Texture *texture; int x, y, width, height; int offset; } update_texture;
+        struct { Render_Vertex_Type vertex_type; int offset; int num_vertices; } draw_immediate;
+        struct { Vertex_Buffer *vertex_buffer; } vertex_buffer; // DRAW_VERTEX_BUFFER and RELEASE_VERTEX_BUFFER.
+        struct { int offset; int num_instances; } draw_sprite_instances;
+    };
+};
+
+struct Recorded_Frame {
+    Array <Render_Command> commands;
+    Array <u8> vertices; // Immediate vertices, kept apart so that a run of them stays contiguous.
+    Array <u8> data;     // Everything else that got copied.
+};
+
+Render_Stats render_stats;
+
+static Recorded_Frame recorded_frames[NUM_RECORDED_FRAMES];
+static Recorded_Frame *recording = &recorded_frames[0];
+
+static Shader *current_shader;
+
+// The immediate vertices that haven't been flushed yet, at the end of recording->vertices.
+static Render_Vertex_Type immediate_vertex_type;
+static int immediate_offset;
+static int num_immediate_vertices;
+
+static std::thread *render_thread;
+static std::mutex frames_mutex;
+static std::condition_variable frame_submitted;
+static std::condition_variable frame_replayed;
+static s64 num_frames_submitted; // Guarded by frames_mutex, and so is everything below.
+static s64 num_frames_replayed;
+static bool render_thread_should_quit;
+
+static Render_Command *add_command(Render_Command_Type type) {
+    Render_Command *command = recording->commands.add();
+    command->type = type;
+
+    render_stats.num_commands += 1;
+    render_stats.num_command_bytes += sizeof(Render_Command);
+    return command;
+}
+
+// Returns the offset of num_bytes of room in array, 16-byte aligned.
+static int push_bytes(Array <u8> *array, s64 num_bytes) {
+    int offset = (array->count + 15) & ~15;
+    s64 end = offset + num_bytes;
+    assert(end <= 0x7fffffff);
+
+    array->reserve((int)end);
+    array->count = (int)end;
+
+    render_stats.num_command_bytes += num_bytes;
+    return offset;
+}
+
+static int copy_to_frame(void *source, s64 num_bytes) {
+    int offset = push_bytes(&recording->data, num_bytes);
+    memcpy(recording->data.data + offset, source, num_bytes);
+    return offset;
+}
+
+static void replay(Recorded_Frame *frame) {
+    u8 *data = frame->data.data;
+
+    for (Render_Command &command : frame->commands) {
+        switch (command.type) {
+            case RENDER_COMMAND_SET_RENDER_TARGETS:
+                backend_set_render_targets(command.set_render_targets.ct, command.set_render_targets.dt);
+                break;
+
+            case RENDER_COMMAND_CLEAR_COLOR_TARGET: {
+                auto c = &command.clear_color_target;
+                backend_clear_color_target(c->ct, c->color[0], c->color[1], c->color[2], c->color[3], c->has_rect ? &c->rect : NULL);
+                break;
+            }
+
+            case RENDER_COMMAND_CLEAR_DEPTH_TARGET:
+                backend_clear_depth_target(command.clear_depth_target.dt, command.clear_depth_target.z);
+                break;
+
+            case RENDER_COMMAND_SET_VIEWPORT:
+                backend_set_viewport(command.rect.x, command.rect.y, command.rect.width, command.rect.height);
+                break;
+
+            case RENDER_COMMAND_SET_SCISSOR:
+                backend_set_scissor(command.rect.x, command.rect.y, command.rect.width, command.rect.height);
+                break;
+
+            case RENDER_COMMAND_SET_SHADER:
+                backend_set_shader(command.set_shader.shader);
+                break;
+
+            case RENDER_COMMAND_SET_GLOBAL_PARAMETERS:
+                backend_set_global_parameters((Global_Parameters *)(data + command.set_global_parameters.offset));
+                break;
+
+            case RENDER_COMMAND_SET_TEXTURE:
+                backend_set_texture(command.set_texture.slot, command.set_texture.texture);
+                break;
+
+            case RENDER_COMMAND_UPDATE_TEXTURE: {
+                auto u = &command.update_texture;
+                backend_update_texture(u->texture, u->x, u->y, u->width, u->height, data + u->offset);
+                break;
+            }
+
+            case RENDER_COMMAND_DRAW_IMMEDIATE: {
+                auto d = &command.draw_immediate;
+                backend_draw_immediate(d->vertex_type, frame->vertices.data + d->offset, d->num_vertices);
+                break;
+            }
+
+            case RENDER_COMMAND_DRAW_VERTEX_BUFFER:
+                backend_draw_vertex_buffer(command.vertex_buffer.vertex_buffer);
+                break;
+
+            case RENDER_COMMAND_DRAW_SPRITE_INSTANCES: {
+                auto d = &command.draw_sprite_instances;
+                backend_draw_sprite_instances((Sprite_Instance *)(data + d->offset), d->num_instances);
+                break;
+            }
+
+            case RENDER_COMMAND_RELEASE_VERTEX_BUFFER:
+                backend_release_vertex_buffer(command.vertex_buffer.vertex_buffer);
+                break;
+
+            case RENDER_COMMAND_PRESENT:
+                backend_present();
+                break;
+        }
+    }
+}
+
+static void render_thread_main() {
+    while (true) {
+        Recorded_Frame *frame = NULL;
+        {
+            std::unique_lock <std::mutex> lock(frames_mutex);
+            frame_submitted.wait(lock, [] { return render_thread_should_quit || num_frames_replayed < num_frames_submitted; });
+            if (num_frames_replayed == num_frames_submitted) return; // Quitting, and nothing is left to replay.
+
+            frame = &recorded_frames[num_frames_replayed % NUM_RECORDED_FRAMES];
+        }
+
+        replay(frame);
+
+        {
+            std::lock_guard <std::mutex> lock(frames_mutex);
+            num_frames_replayed += 1;
+        }
+        frame_replayed.notify_all();
+    }
+}
+
+// Hands what was recorded so far to the render thread and starts recording into the next
+// frame, once the render thread is done with it.
+static void submit_recorded_frame() {
+    immediate_flush();
+    if (!recording->commands.count) return;
+
+    std::unique_lock <std::mutex> lock(frames_mutex);
+    num_frames_submitted += 1;
+    frame_submitted.notify_one();
+
+    frame_replayed.wait(lock, [] { return num_frames_submitted - num_frames_replayed < NUM_RECORDED_FRAMES; });
+
+    recording = &recorded_frames[num_frames_submitted % NUM_RECORDED_FRAMES];
+    recording->commands.clear();
+    recording->vertices.clear();
+    recording->data.clear();
+}
+
+void wait_for_render_thread() {
+    submit_recorded_frame();
+
+    std::unique_lock <std::mutex> lock(frames_mutex);
+    frame_replayed.wait(lock, [] { return num_frames_replayed == num_frames_submitted; });
+}
+
+void init_render(Window_Type window_handle, int width, int height, bool vsync) {
+    backend_init(window_handle, width, height, vsync);
+
+    assert(!render_thread);
+    render_thread = new std::thread(render_thread_main);
+}
+
+void shutdown_render() {
+    if (!render_thread) return;
+
+    wait_for_render_thread();
+    {
+        std::lock_guard <std::mutex> lock(frames_mutex);
+        render_thread_should_quit = true;
+    }
+    frame_submitted.notify_one();
+
+    render_thread->join();
+    delete render_thread;
+    render_thread = NULL;
+}
+
+void swap_buffers() {
+    immediate_flush();
+    add_command(RENDER_COMMAND_PRESENT);
+    submit_recorded_frame();
+
+    render_stats = Render_Stats();
+}
+
+void render_resize(int width, int height) {
+    wait_for_render_thread();
+    backend_resize(width, height);
+}
+
+Color_Target *create_color_target(int width, int height) {
+    return backend_create_color_target(width, height);
+}
+
+void release_color_target(Color_Target *ct) {
+    wait_for_render_thread();
+    backend_release_color_target(ct);
+}
+
+void set_render_targets(Color_Target *ct, Depth_Target *dt) {
+    Render_Command *command = add_command(RENDER_COMMAND_SET_RENDER_TARGETS);
+    command->set_render_targets.ct = ct;
+    command->set_render_targets.dt = dt;
+}
+
+void clear_color_target(Color_Target *ct, float r, float g, float b, float a, Rectangle2i *rect) {
+    Render_Command *command = add_command(RENDER_COMMAND_CLEAR_COLOR_TARGET);
+    auto c = &command->clear_color_target;
+    c->ct = ct;
+    c->color[0] = r;
+    c->color[1] = g;
+    c->color[2] = b;
+    c->color[3] = a;
+    c->has_rect = rect != NULL;
+    if (rect) c->rect = *rect;
+}
+
+void clear_depth_target(Depth_Target *dt, float z) {
+    Render_Command *command = add_command(RENDER_COMMAND_CLEAR_DEPTH_TARGET);
+    command->clear_depth_target.dt = dt;
+    command->clear_depth_target.z = z;
+}
+
+void set_viewport(int x, int y, int width, int height) {
+    Render_Command *command = add_command(RENDER_COMMAND_SET_VIEWPORT);
+    command->rect = { x, y, width, height };
+}
+
+void set_scissor(int x, int y, int width, int height) {
+    Render_Command *command = add_command(RENDER_COMMAND_SET_SCISSOR);
+    command->rect = { x, y, width, height };
+}
+
+Vertex_Buffer *create_vertex_buffer(Render_Vertex_Type vertex_type, void *vertices, int num_vertices) {
+    return backend_create_vertex_buffer(vertex_type, vertices, num_vertices);
+}
+
+void release_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    if (!vertex_buffer) return;
+
+    Render_Command *command = add_command(RENDER_COMMAND_RELEASE_VERTEX_BUFFER);
+    command->vertex_buffer.vertex_buffer = vertex_buffer;
+}
+
+void draw_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    immediate_flush();
+
+    Render_Command *command = add_command(RENDER_COMMAND_DRAW_VERTEX_BUFFER);
+    command->vertex_buffer.vertex_buffer = vertex_buffer;
+
+    render_stats.num_draw_calls += 1;
+    render_stats.num_vertices += vertex_buffer->num_vertices;
+}
+
+void draw_sprite_instances(Sprite_Instance *instances, int num_instances) {
+    Sprite_Instance *dest = draw_sprite_instances(num_instances);
+    memcpy(dest, instances, num_instances * sizeof(Sprite_Instance));
+}
+
+Sprite_Instance *draw_sprite_instances(int num_instances) {
+    immediate_flush();
+
+    // All in one piece, so that the caller can fill it in at once. The draws each take their part.
+    int offset = push_bytes(&recording->data, num_instances * sizeof(Sprite_Instance));
+
+    int first = 0;
+    while (first < num_instances) {
+        int count = Min(num_instances - first, MAX_SPRITE_INSTANCES_PER_DRAW);
+        s64 num_bytes = count * sizeof(Sprite_Instance);
+
+        Render_Command *command = add_command(RENDER_COMMAND_DRAW_SPRITE_INSTANCES);
+        command->draw_sprite_instances.offset = offset + first * (int)sizeof(Sprite_Instance);
+        command->draw_sprite_instances.num_instances = count;
+
+        render_stats.num_draw_calls += 1;
+        render_stats.num_vertices += count * 4;
+        render_stats.num_bytes_uploaded += num_bytes;
+
+        first += count;
+    }
+
+    return (Sprite_Instance *)(recording->data.data + offset);
+}
+
+void immediate_begin() {
+    immediate_flush();
+}
+
+void immediate_flush() {
+    if (!num_immediate_vertices) return;
+
+    Render_Command *command = add_command(RENDER_COMMAND_DRAW_IMMEDIATE);
+    command->draw_immediate.vertex_type = immediate_vertex_type;
+    command->draw_immediate.offset = immediate_offset;
+    command->draw_immediate.num_vertices = num_immediate_vertices;
+
+    render_stats.num_draw_calls += 1;
+    render_stats.num_vertices += num_immediate_vertices;
+    render_stats.num_bytes_uploaded += num_immediate_vertices * get_vertex_size(immediate_vertex_type);
+
+    num_immediate_vertices = 0;
+}
+
+// Room for count more vertices of vertex_type in the current run, flushing it first if it is
+// of another type or would get bigger than a backend can draw at once.
+static void *add_immediate_vertices(Render_Vertex_Type vertex_type, int count, int max_vertices) {
+    if (num_immediate_vertices && (immediate_vertex_type != vertex_type || num_immediate_vertices + count > max_vertices)) {
+        immediate_flush();
+    }
+
+    int vertex_size = get_vertex_size(vertex_type);
+    int offset = push_bytes(&recording->vertices, count * vertex_size);
+    if (!num_immediate_vertices) {
+        immediate_vertex_type = vertex_type;
+        immediate_offset = offset;
+    }
+    assert(offset == immediate_offset + num_immediate_vertices * vertex_size);
+
+    num_immediate_vertices += count;
+    return recording->vertices.data + offset;
+}
+
+static void put_vertex(Vertex_XCUN *v, Vector3 position, Vector2 uv, Vector4 color) {
+    v->position = position;
+    v->color = color;
+    v->uv = uv;
+    v->normal = Vector3(0, 0, 1);
+}
+
+static void put_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
+    Vertex_XCUN *v = (Vertex_XCUN *)add_immediate_vertices(RENDER_VERTEX_XCUN, 6, MAX_IMMEDIATE_VERTICES);
+
+    put_vertex(&v[0], p0, uv0, color);
+    put_vertex(&v[1], p1, uv1, color);
+    put_vertex(&v[2], p2, uv2, color);
+
+    put_vertex(&v[3], p0, uv0, color);
+    put_vertex(&v[4], p2, uv2, color);
+    put_vertex(&v[5], p3, uv3, color);
+}
+
+void immediate_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector4 color) {
+    put_quad(p0, p1, p2, p3, Vector2(0, 0), Vector2(0, 0), Vector2(0, 0), Vector2(0, 0), color);
+}
+
+void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector4 color) {
+    put_quad(Vector3(p0.x, p0.y, 0), Vector3(p1.x, p1.y, 0), Vector3(p2.x, p2.y, 0), Vector3(p3.x, p3.y, 0), Vector2(0, 0), Vector2(0, 0), Vector2(0, 0), Vector2(0, 0), color);
+}
+
+void immediate_quad(float x0, float y0, float x1, float y1, Vector4 color) {
+    immediate_quad(Vector2(x0, y0), Vector2(x1, y0), Vector2(x1, y1), Vector2(x0, y1), color);
+}
+
+void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
+    put_quad(Vector3(p0.x, p0.y, 0), Vector3(p1.x, p1.y, 0), Vector3(p2.x, p2.y, 0), Vector3(p3.x, p3.y, 0), uv0, uv1, uv2, uv3, color);
+}
+
+void immediate_quad(float x0, float y0, float x1, float y1, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
+    immediate_quad(Vector2(x0, y0), Vector2(x1, y0), Vector2(x1, y1), Vector2(x0, y1), uv0, uv1, uv2, uv3, color);
+}
+
+void immediate_triangle(Vector2 p0, Vector2 p1, Vector2 p2, Vector4 color) {
+    Vertex_XCUN *v = (Vertex_XCUN *)add_immediate_vertices(RENDER_VERTEX_XCUN, 3, MAX_IMMEDIATE_VERTICES);
+
+    put_vertex(&v[0], Vector3(p0.x, p0.y, 0), Vector2(0, 0), color);
+    put_vertex(&v[1], Vector3(p1.x, p1.y, 0), Vector2(0, 0), color);
+    put_vertex(&v[2], Vector3(p2.x, p2.y, 0), Vector2(0, 0), color);
+}
+
+void immediate_sprite_quad(Vector2 p0, Vector2 p2, Vector2 uv0, Vector2 uv1, u32 color) {
+    Vertex_Sprite *v = (Vertex_Sprite *)add_immediate_vertices(RENDER_VERTEX_SPRITE, 4, MAX_IMMEDIATE_SPRITE_QUADS * 4);
+    put_sprite_quad(v, p0, p2, uv0, uv1, color);
+}
+
+Shader *set_shader(Shader *shader) {
+    if (current_shader == shader) return current_shader;
+    if (current_shader) immediate_flush();
+
+    current_shader = shader;
+
+    Render_Command *command = add_command(RENDER_COMMAND_SET_SHADER);
+    command->set_shader.shader = shader;
+
+    return current_shader;
+}
+
+bool load_shader(Shader *shader, char *filepath) {
+    wait_for_render_thread();
+    return backend_load_shader(shader, filepath);
+}
+
+void refresh_global_parameters() {
+    Render_Command *command = add_command(RENDER_COMMAND_SET_GLOBAL_PARAMETERS);
+    command->set_global_parameters.offset = copy_to_frame(&global_parameters, sizeof(global_parameters));
+}
+
+bool load_texture_from_bitmap(Texture *texture, Bitmap *bitmap) {
+    wait_for_render_thread();
+    return backend_load_texture_from_bitmap(texture, bitmap);
+}
+
+bool load_texture_from_file(Texture *texture, char *filepath) {
+    Bitmap bitmap;
+    if (!load_bitmap(&bitmap, filepath)) {
+        log_error("Failed to load bitmap '%s'.\n", filepath);
+        return false;
+    }
+    defer { deinit(&bitmap); };
+    bool loaded_a_texture = load_texture_from_bitmap(texture, &bitmap);
+    return loaded_a_texture;
+}
+
+void set_texture(int slot, Texture *texture) {
+    Render_Command *command = add_command(RENDER_COMMAND_SET_TEXTURE);
+    command->set_texture.slot = slot;
+    command->set_texture.texture = texture;
+}
+
+void update_texture(Texture *texture, int x, int y, int width, int height, u8 *data) {
+    Render_Command *command = add_command(RENDER_COMMAND_UPDATE_TEXTURE);
+    auto u = &command->update_texture;
+    u->texture = texture;
+    u->x = x;
+    u->y = y;
+    u->width = width;
+    u->height = height;
+    u->offset = copy_to_frame(data, (s64)width * height * texture->bytes_per_pixel);
+}
@@ -1,5 +1,8 @@
 #include "pch.h"
-#include "render.h"
+
+#ifdef RENDER_D3D11
+
+#include "render_backend.h"
 #include "array.h"
 #include "game.h"
 
@@ -10,17 +13,16 @@ Color_Target *the_lightmap_buffer = NULL;
 
 static bool should_vsync;
 
-static Shader *current_shader;
-
 static ID3D11Device1 *device;
 static ID3D11DeviceContext1 *device_context;
 static IDXGISwapChain1 *swap_chain;
 
-static const int MAX_IMMEDIATE_VERTICES = 2400;
-static Vertex_XCUN immediate_vertices[MAX_IMMEDIATE_VERTICES];
-static int num_immediate_vertices;
-
 static ID3D11Buffer *immediate_vbo;
+static ID3D11Buffer *immediate_sprite_vbo;
+static ID3D11Buffer *quad_ibo; // 0 1 2 0 2 3 for every quad, shared by the Vertex_Sprite and instanced sprite draws.
+
+static ID3D11Buffer *unit_quad_vbo; // The corners (0, 0) (1, 0) (1, 1) (0, 1), in slot 0 for instanced sprites.
+static ID3D11Buffer *sprite_instance_vbo;
 
 static ID3D11Buffer *global_parameters_cbo;
 
@@ -35,7 +37,7 @@ static void release_rtv() {
     SafeRelease(the_back_buffer->rtv);
 }
 
-void init_render(Window_Type window, int width, int height, bool vsync) {
+void backend_init(Window_Type window, int width, int height, bool vsync) {
     should_vsync = vsync;
     
     //
@@ -49,7 +51,8 @@ void init_render(Window_Type window, int width, int height, bool vsync) {
         ID3D11DeviceContext *base_device_context = NULL;
         defer { SafeRelease(base_device_context); };
 
-        UINT device_create_flags = D3D11_CREATE_DEVICE_SINGLETHREADED | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+        // Not D3D11_CREATE_DEVICE_SINGLETHREADED: the game thread creates things while the render thread draws.
+        UINT device_create_flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
 #ifdef _DEBUG
         device_create_flags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
@@ -102,7 +105,51 @@ void init_render(Window_Type window, int width, int height, bool vsync) {
     immediate_vb_bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     device->CreateBuffer(&immediate_vb_bd, NULL, &immediate_vbo);
 
-    num_immediate_vertices = 0;
+    D3D11_BUFFER_DESC immediate_sprite_vb_bd = immediate_vb_bd;
+    immediate_sprite_vb_bd.ByteWidth = MAX_IMMEDIATE_SPRITE_QUADS * 4 * sizeof(Vertex_Sprite);
+    device->CreateBuffer(&immediate_sprite_vb_bd, NULL, &immediate_sprite_vbo);
+
+    {
+        u16 *indices = new u16[MAX_IMMEDIATE_SPRITE_QUADS * 6];
+        defer { delete [] indices; };
+
+        for (int i = 0; i < MAX_IMMEDIATE_SPRITE_QUADS; i++) {
+            u16 base = (u16)(i * 4);
+            u16 *index = &indices[i * 6];
+            index[0] = base + 0;
+            index[1] = base + 1;
+            index[2] = base + 2;
+            index[3] = base + 0;
+            index[4] = base + 2;
+            index[5] = base + 3;
+        }
+
+        D3D11_BUFFER_DESC quad_ib_bd = {};
+        quad_ib_bd.ByteWidth = MAX_IMMEDIATE_SPRITE_QUADS * 6 * sizeof(u16);
+        quad_ib_bd.Usage = D3D11_USAGE_IMMUTABLE;
+        quad_ib_bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+        D3D11_SUBRESOURCE_DATA quad_ib_data = {};
+        quad_ib_data.pSysMem = indices;
+        device->CreateBuffer(&quad_ib_bd, &quad_ib_data, &quad_ibo);
+    }
+
+    {
+        Vector2 corners[4] = { Vector2(0, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0, 1) };
+
+        D3D11_BUFFER_DESC unit_quad_bd = {};
+        unit_quad_bd.ByteWidth = sizeof(corners);
+        unit_quad_bd.Usage = D3D11_USAGE_IMMUTABLE;
+        unit_quad_bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+        D3D11_SUBRESOURCE_DATA unit_quad_data = {};
+        unit_quad_data.pSysMem = corners;
+        device->CreateBuffer(&unit_quad_bd, &unit_quad_data, &unit_quad_vbo);
+    }
+
+    D3D11_BUFFER_DESC sprite_instance_bd = immediate_vb_bd;
+    sprite_instance_bd.ByteWidth = MAX_SPRITE_INSTANCES_PER_DRAW * sizeof(Sprite_Instance);
+    device->CreateBuffer(&sprite_instance_bd, NULL, &sprite_instance_vbo);
 
     D3D11_BUFFER_DESC global_parameters_cb_bd = {};
     global_parameters_cb_bd.ByteWidth = sizeof(Global_Parameters) + 0xf & 0xfffffff0; // round constant buffer size up to 16 byte boundary
@@ -125,22 +172,22 @@ void init_render(Window_Type window, int width, int height, bool vsync) {
     */
 }
 
-void swap_buffers() {
+void backend_present() {
     swap_chain->Present(should_vsync ? 1 : 0, 0);
 }
 
-void render_resize(int width, int height) {
+void backend_resize(int width, int height) {
     if (!swap_chain) return;
 
     if (the_lightmap_buffer) {
-        release_color_target(the_lightmap_buffer);
+        backend_release_color_target(the_lightmap_buffer);
         delete the_lightmap_buffer->texture;
         delete the_lightmap_buffer;
         the_lightmap_buffer = NULL; // This will get created again when computing render_area in do_one_frame
     }
 
     if (the_offscreen_buffer) {
-        release_color_target(the_offscreen_buffer);
+        backend_release_color_target(the_offscreen_buffer);
         delete the_offscreen_buffer->texture;
         delete the_offscreen_buffer;
         the_offscreen_buffer = NULL; // This will get created again when computing render_area in do_one_frame
@@ -151,7 +198,7 @@ void render_resize(int width, int height) {
     create_rtv();
 }
 
-Color_Target *create_color_target(int width, int height) {
+Color_Target *backend_create_color_target(int width, int height) {
     Color_Target *result = new Color_Target();
     result->texture = new Texture();
     
@@ -185,17 +232,17 @@ Color_Target *create_color_target(int width, int height) {
     return result;
 }
 
-void release_color_target(Color_Target *ct) {
+void backend_release_color_target(Color_Target *ct) {
     SafeRelease(ct->texture->srv);
     SafeRelease(ct->texture->texture);
     SafeRelease(ct->rtv);
 }
 
-void set_render_targets(Color_Target *ct, Depth_Target *dt) {
+void backend_set_render_targets(Color_Target *ct, Depth_Target *dt) {
     device_context->OMSetRenderTargets(ct ? 1 : 0, ct ? &ct->rtv : NULL, dt ? dt->dsv : NULL);
 }
 
-void clear_color_target(Color_Target *ct, float r, float g, float b, float a, Rectangle2i *rect) {
+void backend_clear_color_target(Color_Target *ct, float r, float g, float b, float a, Rectangle2i *rect) {
     if (ct) {
         float clear_color[4] = { r, g, b, a };
 
@@ -211,150 +258,101 @@ void clear_color_target(Color_Target *ct, float r, float g, float b, float a, Re
     }
 }
 
-void clear_depth_target(Depth_Target *dt, float z) {
+void backend_clear_depth_target(Depth_Target *dt, float z) {
     if (dt) {
         device_context->ClearDepthStencilView(dt->dsv, D3D11_CLEAR_DEPTH, z, 0);
     }
 }
 
-void immediate_begin() {
-    immediate_flush();
-}
-
-void immediate_flush() {
-    if (!num_immediate_vertices) return;
-
-    D3D11_MAPPED_SUBRESOURCE msr;
-    device_context->Map(immediate_vbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
-    memcpy(msr.pData, immediate_vertices, num_immediate_vertices * sizeof(Vertex_XCUN));
-    device_context->Unmap(immediate_vbo, 0);
-
-    UINT offsets[1] = { 0 };
-    UINT strides[1] = { sizeof(Vertex_XCUN) };
-    device_context->IASetVertexBuffers(0, 1, &immediate_vbo, strides, offsets);
-
-    device_context->Draw(num_immediate_vertices, 0);
+Vertex_Buffer *backend_create_vertex_buffer(Render_Vertex_Type vertex_type, void *vertices, int num_vertices) {
+    assert(num_vertices > 0);
+    if (vertex_type == RENDER_VERTEX_SPRITE) assert(num_vertices % 4 == 0 && num_vertices <= MAX_IMMEDIATE_SPRITE_QUADS * 4);
     
-    num_immediate_vertices = 0;
-}
+    D3D11_BUFFER_DESC bd = {};
+    bd.ByteWidth = num_vertices * get_vertex_size(vertex_type);
+    bd.Usage = D3D11_USAGE_IMMUTABLE;
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = vertices;
+
+    Vertex_Buffer *vertex_buffer = new Vertex_Buffer();
+    HRESULT hr = device->CreateBuffer(&bd, &data, &vertex_buffer->vbo);
+    if (FAILED(hr)) {
+        log_error("Failed to create a vertex buffer of %d vertices.\n", num_vertices);
+        delete vertex_buffer;
+        return NULL;
+    }
 
-static void put_vertex(Vertex_XCUN *v, Vector3 position, Vector4 color) {
-    v->position = position;
-    v->color = color;
-    v->uv = Vector2(0, 0);
-    v->normal = Vector3(0, 0, 1);
+    vertex_buffer->vertex_type = vertex_type;
+    vertex_buffer->num_vertices = num_vertices;
+    return vertex_buffer;
 }
 
-void immediate_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector4 color) {
-    if (num_immediate_vertices + 6 > MAX_IMMEDIATE_VERTICES) immediate_flush();
+void backend_release_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    if (!vertex_buffer) return;
 
-    Vertex_XCUN *v = immediate_vertices + num_immediate_vertices;
-    
-    put_vertex(&v[0], p0, color);
-    put_vertex(&v[1], p1, color);
-    put_vertex(&v[2], p2, color);
-    
-    put_vertex(&v[3], p0, color);
-    put_vertex(&v[4], p2, color);
-    put_vertex(&v[5], p3, color);
-    
-    num_immediate_vertices += 6;
+    SafeRelease(vertex_buffer->vbo);
+    delete vertex_buffer;
 }
 
-static void put_vertex(Vertex_XCUN *v, Vector2 position, Vector4 color) {
-    v->position.x = position.x;
-    v->position.y = position.y;
-    v->position.z = 0.0f;
-    v->color = color;
-    v->uv = Vector2(0, 0);
-    v->normal = Vector3(0, 0, 1);
-}
-
-static void put_vertex(Vertex_XCUN *v, Vector2 position, Vector2 uv, Vector4 color) {
-    v->position.x = position.x;
-    v->position.y = position.y;
-    v->position.z = 0.0f;
-    v->color = color;
-    v->uv = uv;
-    v->normal = Vector3(0, 0, 1);
-}
-
-void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector4 color) {
-    if (num_immediate_vertices + 6 > MAX_IMMEDIATE_VERTICES) immediate_flush();
+void backend_draw_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    UINT offsets[1] = { 0 };
+    UINT strides[1] = { (UINT)get_vertex_size(vertex_buffer->vertex_type) };
+    device_context->IASetVertexBuffers(0, 1, &vertex_buffer->vbo, strides, offsets);
 
-    Vertex_XCUN *v = immediate_vertices + num_immediate_vertices;
-    
-    put_vertex(&v[0], p0, color);
-    put_vertex(&v[1], p1, color);
-    put_vertex(&v[2], p2, color);
-    
-    put_vertex(&v[3], p0, color);
-    put_vertex(&v[4], p2, color);
-    put_vertex(&v[5], p3, color);
-    
-    num_immediate_vertices += 6;
+    if (vertex_buffer->vertex_type == RENDER_VERTEX_SPRITE) {
+        device_context->IASetIndexBuffer(quad_ibo, DXGI_FORMAT_R16_UINT, 0);
+        device_context->DrawIndexed(vertex_buffer->num_vertices / 4 * 6, 0, 0);
+    } else {
+        device_context->Draw(vertex_buffer->num_vertices, 0);
+    }
 }
 
-void immediate_quad(float x0, float y0, float x1, float y1, Vector4 color) {
-    Vector2 p0(x0, y0);
-    Vector2 p1(x1, y0);
-    Vector2 p2(x1, y1);
-    Vector2 p3(x0, y1);
-    
-    immediate_quad(p0, p1, p2, p3, color);
-}
+void backend_draw_sprite_instances(Sprite_Instance *instances, int num_instances) {
+    assert(num_instances <= MAX_SPRITE_INSTANCES_PER_DRAW);
 
-void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
-    if (num_immediate_vertices + 6 > MAX_IMMEDIATE_VERTICES) immediate_flush();
+    D3D11_MAPPED_SUBRESOURCE msr;
+    device_context->Map(sprite_instance_vbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
+    memcpy(msr.pData, instances, num_instances * sizeof(Sprite_Instance));
+    device_context->Unmap(sprite_instance_vbo, 0);
 
-    Vertex_XCUN *v = immediate_vertices + num_immediate_vertices;
+    ID3D11Buffer *vbos[2] = { unit_quad_vbo, sprite_instance_vbo };
+    UINT strides[2] = { sizeof(Vector2), sizeof(Sprite_Instance) };
+    UINT offsets[2] = { 0, 0 };
+    device_context->IASetVertexBuffers(0, 2, vbos, strides, offsets);
+    device_context->IASetIndexBuffer(quad_ibo, DXGI_FORMAT_R16_UINT, 0);
 
-    put_vertex(&v[0], p0, uv0, color);
-    put_vertex(&v[1], p1, uv1, color);
-    put_vertex(&v[2], p2, uv2, color);
-    
-    put_vertex(&v[3], p0, uv0, color);
-    put_vertex(&v[4], p2, uv2, color);
-    put_vertex(&v[5], p3, uv3, color);
-    
-    num_immediate_vertices += 6;
+    device_context->DrawIndexedInstanced(6, num_instances, 0, 0, 0);
 }
 
-void immediate_quad(float x0, float y0, float x1, float y1, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
-    Vector2 p0(x0, y0);
-    Vector2 p1(x1, y0);
-    Vector2 p2(x1, y1);
-    Vector2 p3(x0, y1);
-
-    immediate_quad(p0, p1, p2, p3, uv0, uv1, uv2, uv3, color);
-}
+void backend_draw_immediate(Render_Vertex_Type vertex_type, void *vertices, int num_vertices) {
+    ID3D11Buffer *vbo = vertex_type == RENDER_VERTEX_SPRITE ? immediate_sprite_vbo : immediate_vbo;
+    UINT stride = (UINT)get_vertex_size(vertex_type);
 
-void immediate_triangle(Vector2 p0, Vector2 p1, Vector2 p2, Vector4 color) {
-    if (num_immediate_vertices + 3 > MAX_IMMEDIATE_VERTICES) immediate_flush();
+    D3D11_MAPPED_SUBRESOURCE msr;
+    device_context->Map(vbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
+    memcpy(msr.pData, vertices, num_vertices * stride);
+    device_context->Unmap(vbo, 0);
 
-    Vertex_XCUN *v = immediate_vertices + num_immediate_vertices;
+    UINT offset = 0;
+    device_context->IASetVertexBuffers(0, 1, &vbo, &stride, &offset);
 
-    put_vertex(&v[0], p0, color);
-    put_vertex(&v[1], p1, color);
-    put_vertex(&v[2], p2, color);
-    
-    num_immediate_vertices += 3;
+    if (vertex_type == RENDER_VERTEX_SPRITE) {
+        assert(num_vertices <= MAX_IMMEDIATE_SPRITE_QUADS * 4);
+        device_context->IASetIndexBuffer(quad_ibo, DXGI_FORMAT_R16_UINT, 0);
+        device_context->DrawIndexed(num_vertices / 4 * 6, 0, 0);
+    } else {
+        assert(num_vertices <= MAX_IMMEDIATE_VERTICES);
+        device_context->Draw(num_vertices, 0);
+    }
 }
 
-Shader *set_shader(Shader *shader) {
-    if (current_shader == shader) return current_shader;
-    if (current_shader) immediate_flush();
-    
-    current_shader = shader;
-
+void backend_set_shader(Shader *shader) {
     device_context->VSSetShader(shader->vs, NULL, 0);
     device_context->PSSetShader(shader->ps, NULL, 0);
     device_context->IASetInputLayout(shader->il);
-    if (globals.render_type == RENDER_TYPE_LIGHTS) {
-        device_context->OMSetBlendState(NULL, NULL, 0xFFFFFFFF);
-    } else {
-        device_context->OMSetBlendState(shader->blend_state, NULL, 0xFFFFFFFF);
-    }
+    device_context->OMSetBlendState(shader->blend_state, NULL, 0xFFFFFFFF);
     device_context->RSSetState(shader->rasterizer_state);
     device_context->OMSetDepthStencilState(shader->depth_stencil_state, 0);
     device_context->IASetPrimitiveTopology(shader->topology);
@@ -363,8 +361,6 @@ Shader *set_shader(Shader *shader) {
     ID3D11Buffer *cbs[] = { global_parameters_cbo };
     
     device_context->VSSetConstantBuffers(0, ArrayCount(cbs), cbs);
-    
-    return current_shader;
 }
 
 static D3D11_CULL_MODE d3d11_cull_mode(Cull_Mode cull_mode) {
@@ -423,6 +419,66 @@ bool load_shader_from_memory(Shader *shader, char *preprocessed_text, char *file
         ieds[3].AlignedByteOffset = offsetof(Vertex_XCUN, normal);
         ieds[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
         
+        break;
+
+    case RENDER_VERTEX_SPRITE:
+        num_ieds = 3;
+
+        ieds[0].SemanticName = "POSITION";
+        ieds[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+        ieds[0].AlignedByteOffset = offsetof(Vertex_Sprite, position);
+        ieds[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+        ieds[1].SemanticName = "TEXCOORD";
+        ieds[1].Format = DXGI_FORMAT_R16G16_UNORM;
+        ieds[1].AlignedByteOffset = offsetof(Vertex_Sprite, uv);
+        ieds[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+        ieds[2].SemanticName = "COLOR";
+        ieds[2].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        ieds[2].AlignedByteOffset = offsetof(Vertex_Sprite, color);
+        ieds[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+        break;
+
+    case RENDER_VERTEX_SPRITE_INSTANCE:
+        num_ieds = 5;
+
+        ieds[0].SemanticName = "CORNER";
+        ieds[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+        ieds[0].InputSlot = 0;
+        ieds[0].AlignedByteOffset = 0;
+        ieds[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+        ieds[1].SemanticName = "POSITION";
+        ieds[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+        ieds[1].InputSlot = 1;
+        ieds[1].AlignedByteOffset = offsetof(Sprite_Instance, position);
+        ieds[1].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        ieds[1].InstanceDataStepRate = 1;
+
+        ieds[2].SemanticName = "SIZE";
+        ieds[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+        ieds[2].InputSlot = 1;
+        ieds[2].AlignedByteOffset = offsetof(Sprite_Instance, size);
+        ieds[2].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        ieds[2].InstanceDataStepRate = 1;
+
+        // uv0 and uv1 together, as xy and zw.
+        ieds[3].SemanticName = "UV_RECT";
+        ieds[3].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+        ieds[3].InputSlot = 1;
+        ieds[3].AlignedByteOffset = offsetof(Sprite_Instance, uv0);
+        ieds[3].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        ieds[3].InstanceDataStepRate = 1;
+
+        ieds[4].SemanticName = "COLOR";
+        ieds[4].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        ieds[4].InputSlot = 1;
+        ieds[4].AlignedByteOffset = offsetof(Sprite_Instance, color);
+        ieds[4].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        ieds[4].InstanceDataStepRate = 1;
+
         break;
     }
 
@@ -959,10 +1015,16 @@ static char *preprocess_shader(Shader *shader, char *data) {
             
             if (strings_match(line, "XCUN") || strings_match(line, "xcun")) {
                 options.vertex_type = RENDER_VERTEX_XCUN;
+            } else if (strings_match(line, "Sprite") || strings_match(line, "sprite")) {
+                options.vertex_type = RENDER_VERTEX_SPRITE;
+            } else if (strings_match(line, "Sprite_Instance") || strings_match(line, "sprite_instance")) {
+                options.vertex_type = RENDER_VERTEX_SPRITE_INSTANCE;
             } else {
                 log_error("VertexType mode '%s' not supported\n", line);
                 log_error("Valid values are:\n");
                 log_error("    XCUN\n");
+                log_error("    Sprite\n");
+                log_error("    Sprite_Instance\n");
                 return NULL;
             }
         } else if (starts_with(line, "RenderTopology")) {
@@ -1064,24 +1126,7 @@ static char *preprocess_shader(Shader *shader, char *data) {
     return concatenate_with_newlines(lines.data, lines.count);
 }
 
-char *read_entire_text_file(char *filepath) {
-    char *result = NULL;
-
-    FILE *file = fopen(filepath, "rt");
-    if (file) {
-        fseek(file, 0, SEEK_END);
-        size_t length = ftell(file);
-        fseek(file, 0, SEEK_SET);
-
-        result = new char[length + 1];
-        size_t num_read = fread(result, 1, length, file);
-        result[num_read] = 0;
-        fclose(file);
-    }
-    return result;
-}
-
-bool load_shader(Shader *shader, char *filepath) {
+bool backend_load_shader(Shader *shader, char *filepath) {
     char *data = read_entire_text_file(filepath);
     if (!data) return false;
     defer { delete [] data; };
@@ -1094,14 +1139,14 @@ bool load_shader(Shader *shader, char *filepath) {
     return success;
 }
 
-void refresh_global_parameters() {
+void backend_set_global_parameters(Global_Parameters *parameters) {
     D3D11_MAPPED_SUBRESOURCE msr;
     device_context->Map(global_parameters_cbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
-    memcpy(msr.pData, &global_parameters, sizeof(global_parameters));
+    memcpy(msr.pData, parameters, sizeof(*parameters));
     device_context->Unmap(global_parameters_cbo, 0);
 }
 
-void set_viewport(int x, int y, int width, int height) {
+void backend_set_viewport(int x, int y, int width, int height) {
     D3D11_VIEWPORT vp;
     vp.TopLeftX = (float)x;
     vp.TopLeftY = (float)y;
@@ -1112,7 +1157,7 @@ void set_viewport(int x, int y, int width, int height) {
     device_context->RSSetViewports(1, &vp);
 }
 
-void set_scissor(int x, int y, int width, int height) {
+void backend_set_scissor(int x, int y, int width, int height) {
     D3D11_RECT rect;
     rect.left = x;
     rect.right = x + width;
@@ -1121,7 +1166,7 @@ void set_scissor(int x, int y, int width, int height) {
     device_context->RSSetScissorRects(1, &rect);
 }
 
-bool load_texture_from_bitmap(Texture *texture, Bitmap *bitmap) {
+bool backend_load_texture_from_bitmap(Texture *texture, Bitmap *bitmap) {
     assert(bitmap->format != TEXTURE_FORMAT_UNKNOWN);
 
     texture->width = bitmap->width;
@@ -1165,22 +1210,11 @@ bool load_texture_from_bitmap(Texture *texture, Bitmap *bitmap) {
     return true;
 }
 
-bool load_texture_from_file(Texture *texture, char *filepath) {
-    Bitmap bitmap;
-    if (!load_bitmap(&bitmap, filepath)) {
-        log_error("Failed to load bitmap '%s'.\n", filepath);
-        return false;
-    }
-    defer { deinit(&bitmap); };
-    bool loaded_a_texture = load_texture_from_bitmap(texture, &bitmap);
-    return loaded_a_texture;
-}
-
-void set_texture(int slot, Texture *texture) {
+void backend_set_texture(int slot, Texture *texture) {
     device_context->PSSetShaderResources(slot, 1, &texture->srv);
 }
 
-void update_texture(Texture *texture, int x, int y, int width, int height, u8 *data) {
+void backend_update_texture(Texture *texture, int x, int y, int width, int height, u8 *data) {
     D3D11_BOX box;
     box.left = x;
     box.right = box.left + width;
@@ -1192,3 +1226,4 @@ void update_texture(Texture *texture, int x, int y, int width, int height, u8 *d
     device_context->UpdateSubresource(texture->texture, 0, &box, data, width * texture->bytes_per_pixel, 0);
 }
 
+#endif
@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#ifdef RENDER_NULL
+
+//
+// Renderer that draws nothing, for running the game without a window or a GPU (the headless
+// runner, build machines). Textures still get loaded so that their sizes are right. The render
+// thread replays recorded frames into this just like into D3D11: vertices, instances and
+// texture data get copied out to stand in for the uploads, and everything gets counted in
+// null_replay_counts, so that the headless runner can time recording against a backend that
+// costs next to nothing.
+//
+
+#include "render_backend.h"
+#include "array.h"
+#include "game.h"
+#include "os.h"
+
+Null_Replay_Counts null_replay_counts;
+
+Color_Target *the_back_buffer = NULL;
+
+Color_Target *the_offscreen_buffer = NULL;
+Color_Target *the_lightmap_buffer = NULL;
+
+// Stands in for the mapped vertex buffers, big enough for the biggest of them.
+const int UPLOAD_BUFFER_SIZE = MAX_IMMEDIATE_VERTICES * sizeof(Vertex_XCUN);
+static_assert(UPLOAD_BUFFER_SIZE >= MAX_IMMEDIATE_SPRITE_QUADS * 4 * sizeof(Vertex_Sprite), "");
+static_assert(UPLOAD_BUFFER_SIZE >= MAX_SPRITE_INSTANCES_PER_DRAW * sizeof(Sprite_Instance), "");
+static u8 upload_buffer[UPLOAD_BUFFER_SIZE];
+
+void backend_init(Window_Type, int width, int height, bool) {
+    the_back_buffer = new Color_Target();
+    the_back_buffer->texture = new Texture();
+    the_back_buffer->texture->width = width;
+    the_back_buffer->texture->height = height;
+}
+
+void backend_present() {
+    null_replay_counts.num_frames += 1;
+}
+
+void backend_resize(int width, int height) {
+    if (!the_back_buffer) return;
+
+    the_back_buffer->texture->width = width;
+    the_back_buffer->texture->height = height;
+}
+
+Color_Target *backend_create_color_target(int width, int height) {
+    Color_Target *result = new Color_Target();
+    result->texture = new Texture();
+    result->texture->width = width;
+    result->texture->height = height;
+    result->texture->format = TEXTURE_FORMAT_RGBA8;
+    result->texture->bytes_per_pixel = 4;
+    return result;
+}
+
+void backend_release_color_target(Color_Target *) {
+}
+
+void backend_set_render_targets(Color_Target *, Depth_Target *) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_clear_color_target(Color_Target *, float, float, float, float, Rectangle2i *) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_clear_depth_target(Depth_Target *, float) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_set_viewport(int, int, int, int) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_set_scissor(int, int, int, int) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_set_shader(Shader *) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_set_global_parameters(Global_Parameters *) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_set_texture(int, Texture *) {
+    null_replay_counts.num_state_changes += 1;
+}
+
+void backend_update_texture(Texture *texture, int, int, int width, int height, u8 *) {
+    null_replay_counts.num_bytes_uploaded += (s64)width * height * texture->bytes_per_pixel;
+}
+
+Vertex_Buffer *backend_create_vertex_buffer(Render_Vertex_Type vertex_type, void *, int num_vertices) {
+    assert(num_vertices > 0);
+    if (vertex_type == RENDER_VERTEX_SPRITE) assert(num_vertices % 4 == 0 && num_vertices <= MAX_IMMEDIATE_SPRITE_QUADS * 4);
+
+    Vertex_Buffer *vertex_buffer = new Vertex_Buffer();
+    vertex_buffer->vertex_type = vertex_type;
+    vertex_buffer->num_vertices = num_vertices;
+    return vertex_buffer;
+}
+
+void backend_release_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    delete vertex_buffer;
+}
+
+void backend_draw_vertex_buffer(Vertex_Buffer *vertex_buffer) {
+    null_replay_counts.num_draw_calls += 1;
+    null_replay_counts.num_vertices += vertex_buffer->num_vertices;
+}
+
+void backend_draw_immediate(Render_Vertex_Type vertex_type, void *vertices, int num_vertices) {
+    s64 num_bytes = num_vertices * get_vertex_size(vertex_type);
+    assert(num_bytes <= UPLOAD_BUFFER_SIZE);
+    memcpy(upload_buffer, vertices, num_bytes);
+
+    null_replay_counts.num_draw_calls += 1;
+    null_replay_counts.num_vertices += num_vertices;
+    null_replay_counts.num_bytes_uploaded += num_bytes;
+}
+
+void backend_draw_sprite_instances(Sprite_Instance *instances, int num_instances) {
+    assert(num_instances <= MAX_SPRITE_INSTANCES_PER_DRAW);
+
+    s64 num_bytes = num_instances * sizeof(Sprite_Instance);
+    memcpy(upload_buffer, instances, num_bytes);
+
+    null_replay_counts.num_draw_calls += 1;
+    null_replay_counts.num_vertices += num_instances * 4;
+    null_replay_counts.num_bytes_uploaded += num_bytes;
+}
+
+bool backend_load_shader(Shader *, char *filepath) {
+    // Nothing gets compiled, but the file still has to be there like it would for a real backend.
+    return file_exists(filepath);
+}
+
+bool backend_load_texture_from_bitmap(Texture *texture, Bitmap *bitmap) {
+    assert(bitmap->format != TEXTURE_FORMAT_UNKNOWN);
+
+    texture->width = bitmap->width;
+    texture->height = bitmap->height;
+    texture->format = bitmap->format;
+    texture->bytes_per_pixel = bitmap->bytes_per_pixel;
+
+    return true;
+}
+
+#endif
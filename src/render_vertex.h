@@ -4,6 +4,8 @@
 
 enum Render_Vertex_Type {
     RENDER_VERTEX_XCUN,
+    RENDER_VERTEX_SPRITE,
+    RENDER_VERTEX_SPRITE_INSTANCE,
 };
 
 struct Vertex_XCUN {
@@ -12,3 +14,70 @@ struct Vertex_XCUN {
     Vector2 uv;
     Vector3 normal;
 };
+
+// 16 bytes instead of Vertex_XCUN's 48, for 2D quads. uv is UNORM16 and color is RGBA8, so
+// shaders see them as floats like before. Always drawn as indexed quads of four vertices
+// (p0, p1, p2, p3 going around), so a quad costs 64 bytes instead of 288.
+struct Vertex_Sprite {
+    Vector2 position;
+    u16 uv[2];
+    u32 color;
+};
+
+inline u16 pack_unorm16(float f) {
+    f = Clamp(f, 0.0f, 1.0f);
+    return (u16)(f * 65535.0f + 0.5f);
+}
+
+inline u32 pack_rgba8(Vector4 color) {
+    u32 r = (u32)(Clamp(color.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 g = (u32)(Clamp(color.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 b = (u32)(Clamp(color.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 a = (u32)(Clamp(color.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+inline void put_sprite_vertex(Vertex_Sprite *v, Vector2 position, Vector2 uv, u32 color) {
+    v->position = position;
+    v->uv[0] = pack_unorm16(uv.x);
+    v->uv[1] = pack_unorm16(uv.y);
+    v->color = color;
+}
+
+// p0 is the bottom left corner and p2 the top right, uv0 and uv1 likewise.
+inline void put_sprite_quad(Vertex_Sprite *v, Vector2 p0, Vector2 p2, Vector2 uv0, Vector2 uv1, u32 color) {
+    put_sprite_vertex(&v[0], p0, uv0, color);
+    put_sprite_vertex(&v[1], Vector2(p2.x, p0.y), Vector2(uv1.x, uv0.y), color);
+    put_sprite_vertex(&v[2], p2, uv1, color);
+    put_sprite_vertex(&v[3], Vector2(p0.x, p2.y), Vector2(uv0.x, uv1.y), color);
+}
+
+// One sprite of an instanced draw, see draw_sprite_instances. The vertex shader places a unit
+// quad with it, so it's all a sprite costs: 28 bytes instead of four Vertex_Sprites.
+struct Sprite_Instance {
+    Vector2 position; // Bottom left.
+    Vector2 size;
+    u16 uv0[2]; // Bottom left, UNORM16.
+    u16 uv1[2]; // Top right, UNORM16.
+    u32 color;
+};
+static_assert(sizeof(Sprite_Instance) == 28, "");
+
+inline void put_sprite_instance(Sprite_Instance *instance, Vector2 position, Vector2 size, Vector2 uv0, Vector2 uv1, u32 color) {
+    instance->position = position;
+    instance->size = size;
+    instance->uv0[0] = pack_unorm16(uv0.x);
+    instance->uv0[1] = pack_unorm16(uv0.y);
+    instance->uv1[0] = pack_unorm16(uv1.x);
+    instance->uv1[1] = pack_unorm16(uv1.y);
+    instance->color = color;
+}
+
+inline int get_vertex_size(Render_Vertex_Type vertex_type) {
+    switch (vertex_type) {
+        case RENDER_VERTEX_XCUN: return sizeof(Vertex_XCUN);
+        case RENDER_VERTEX_SPRITE: return sizeof(Vertex_Sprite);
+        case RENDER_VERTEX_SPRITE_INSTANCE: return sizeof(Sprite_Instance);
+    }
+    return 0;
+}
@@ -86,7 +86,8 @@ struct Shader {
     u64 modtime;
 
     Shader_Options options;
-    
+
+#ifdef RENDER_D3D11
     ID3D11VertexShader *vs = 0;
     ID3D11PixelShader *ps = 0;
     ID3D11InputLayout *il = 0;
@@ -95,6 +96,7 @@ struct Shader {
     ID3D11DepthStencilState *depth_stencil_state = 0;
     D3D11_PRIMITIVE_TOPOLOGY topology;
     Array <ID3D11SamplerState *> sampler_states;
+#endif
 };
 
 struct Global_Parameters {
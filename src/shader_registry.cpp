@@ -36,17 +36,17 @@ Shader *Shader_Registry::get(char *name) {
     return shader;
 }
 
-void Shader_Registry::do_hotloading() {
-    for (int i = 0; i < loaded_shaders.count; i++) {
-        Shader *shader = loaded_shaders[i];
-
-        u64 modtime = shader->modtime;
-        bool success = get_file_last_write_time(shader->full_path, &modtime);
-        if (!success) continue;
-
-        if (shader->modtime != modtime) {
-            shader->modtime = modtime;
-            load_shader(shader, shader->full_path);
-        }
-    }
+bool Shader_Registry::hotload(char *full_path) {
+    char *name = get_asset_name_from_path(full_path, SHADER_DIRECTORY);
+    if (!name) return false;
+
+    Shader **_shader = shader_lookup.find(name);
+    if (!_shader) return true;
+
+    Shader *shader = *_shader;
+    if (!strings_match(shader->full_path, full_path)) return true; // Same name, different extension.
+
+    get_file_last_write_time(full_path, &shader->modtime);
+    load_shader(shader, full_path);
+    return true;
 }
@@ -13,5 +13,5 @@ struct Shader_Registry {
     Array <Shader *> loaded_shaders;
     
     Shader *get(char *name);
-    void do_hotloading();
+    bool hotload(char *full_path);
 };
@@ -0,0 +1,307 @@
+#include "pch.h"
+#include "shadow_segments.h"
+#include "entities.h"
+#include "entity_manager.h"
+#include "render.h"
+#include "tilemap_collision.h"
+#include "tilemap_mesh.h"
+
+Shadow_Stats shadow_stats;
+
+static Array <Light_Shadow *> light_shadows;
+static Hash_Table <u64, Light_Shadow *> light_shadow_lookup;
+static u32 shadow_frame_index = 1;
+
+static bool casts_shadow(Entity *e) {
+    return e->type == ENTITY_TYPE_TREE;
+}
+
+static void add_edge(Array <Shadow_Edge> *edges, Vector2 a, Vector2 b, Vector2 normal) {
+    Shadow_Edge edge;
+    edge.a = a;
+    edge.b = b;
+    edge.normal = normal;
+    edges->add(edge);
+}
+
+// Outlines of the collidable tiles in x0..x1, y0..y1 (exclusive), merged into runs. A bucket
+// owns the tile boundaries at its left and bottom, and the ones at its right and top if those
+// are the edges of the map.
+static void build_bucket_edges(Tilemap *tilemap, Array <Shadow_Edge> *edges, Vector2 origin, int x0, int y0, int x1, int y1) {
+    int boundary_y1 = (y1 == tilemap->height) ? y1 : y1 - 1;
+    for (int y = y0; y <= boundary_y1; y++) {
+        int run_start = x0;
+        int run_kind = 0; // 1: solid below, 2: solid above.
+        for (int x = x0; x <= x1; x++) {
+            int kind = 0;
+            if (x < x1) {
+                bool below = is_tile_collidable(tilemap, x, y - 1);
+                bool above = is_tile_collidable(tilemap, x, y);
+                if (below && !above) kind = 1;
+                if (above && !below) kind = 2;
+            }
+
+            if (kind == run_kind) continue;
+
+            if (run_kind) {
+                Vector2 a = origin + Vector2((float)run_start, (float)y);
+                Vector2 b = origin + Vector2((float)x, (float)y);
+                add_edge(edges, a, b, Vector2(0, run_kind == 1 ? 1.0f : -1.0f));
+            }
+
+            run_start = x;
+            run_kind = kind;
+        }
+    }
+
+    int boundary_x1 = (x1 == tilemap->width) ? x1 : x1 - 1;
+    for (int x = x0; x <= boundary_x1; x++) {
+        int run_start = y0;
+        int run_kind = 0; // 1: solid on the left, 2: solid on the right.
+        for (int y = y0; y <= y1; y++) {
+            int kind = 0;
+            if (y < y1) {
+                bool left = is_tile_collidable(tilemap, x - 1, y);
+                bool right = is_tile_collidable(tilemap, x, y);
+                if (left && !right) kind = 1;
+                if (right && !left) kind = 2;
+            }
+
+            if (kind == run_kind) continue;
+
+            if (run_kind) {
+                Vector2 a = origin + Vector2((float)x, (float)run_start);
+                Vector2 b = origin + Vector2((float)x, (float)y);
+                add_edge(edges, a, b, Vector2(run_kind == 1 ? 1.0f : -1.0f, 0));
+            }
+
+            run_start = y;
+            run_kind = kind;
+        }
+    }
+}
+
+static Tilemap_Shadow_Edges *get_tilemap_shadow_edges(Tilemap *tilemap) {
+    Tilemap_Shadow_Edges *result = tilemap->shadow_edges;
+    Vector2 origin = tilemap->position();
+
+    bool out_of_date = !result || result->collision_generation != tilemap->collision_generation;
+    out_of_date = out_of_date || result->origin.x != origin.x || result->origin.y != origin.y;
+    if (!out_of_date) return result;
+
+    release_tilemap_shadow_edges(tilemap);
+
+    result = new Tilemap_Shadow_Edges();
+    result->collision_generation = tilemap->collision_generation;
+    result->origin = origin;
+    result->num_buckets_x = (tilemap->width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    result->num_buckets_y = (tilemap->height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    result->buckets = new Array <Shadow_Edge>[result->num_buckets_x * result->num_buckets_y];
+
+    if (tilemap->collision_bits) {
+        for (int by = 0; by < result->num_buckets_y; by++) {
+            for (int bx = 0; bx < result->num_buckets_x; bx++) {
+                int x0 = bx * TILEMAP_CHUNK_SIZE;
+                int y0 = by * TILEMAP_CHUNK_SIZE;
+                int x1 = Min(x0 + TILEMAP_CHUNK_SIZE, tilemap->width);
+                int y1 = Min(y0 + TILEMAP_CHUNK_SIZE, tilemap->height);
+
+                build_bucket_edges(tilemap, &result->buckets[by * result->num_buckets_x + bx], origin, x0, y0, x1, y1);
+            }
+        }
+    }
+
+    tilemap->shadow_edges = result;
+    return result;
+}
+
+void release_tilemap_shadow_edges(Tilemap *tilemap) {
+    if (!tilemap->shadow_edges) return;
+
+    delete [] tilemap->shadow_edges->buckets;
+    delete tilemap->shadow_edges;
+    tilemap->shadow_edges = NULL;
+}
+
+static float distance_squared_to_segment(Vector2 p, Vector2 a, Vector2 b) {
+    Vector2 ab = b - a;
+    float length_squared = dot_product(ab, ab);
+    float t = length_squared > 0.0f ? Clamp(dot_product(p - a, ab) / length_squared, 0.0f, 1.0f) : 0.0f;
+
+    Vector2 d = p - (a + ab * t);
+    return dot_product(d, d);
+}
+
+// Only the edges that face away from the light cast a shadow, that way the occluder itself stays lit.
+static bool edge_casts_shadow(Shadow_Edge *edge, Vector2 center, float radius) {
+    Vector2 middle = (edge->a + edge->b) * 0.5f;
+    if (dot_product(edge->normal, center - middle) >= 0.0f) return false;
+
+    return distance_squared_to_segment(center, edge->a, edge->b) <= radius * radius;
+}
+
+static void add_box_edges(Array <Shadow_Edge> *edges, Vector2 min, Vector2 max) {
+    add_edge(edges, min, Vector2(max.x, min.y), Vector2(0, -1));
+    add_edge(edges, Vector2(max.x, min.y), max, Vector2(1, 0));
+    add_edge(edges, max, Vector2(min.x, max.y), Vector2(0, 1));
+    add_edge(edges, Vector2(min.x, max.y), min, Vector2(-1, 0));
+}
+
+static u64 float_bits(Vector2 v) {
+    u32 x, y;
+    memcpy(&x, &v.x, sizeof(x));
+    memcpy(&y, &v.y, sizeof(y));
+    return ((u64)y << 32) | x;
+}
+
+// Order doesn't matter: the grid can report the same casters in another order after they move around.
+static u64 get_casters_checksum(Array <Entity *> *casters) {
+    u64 result = 0;
+    for (Entity *e : *casters) {
+        result += hash(hash(hash((u64)e->handle.value) ^ float_bits(e->position())) ^ float_bits(e->size()));
+    }
+    return result;
+}
+
+static void put_shadow_vertex(Vertex_XCUN *v, Vector2 p, float z) {
+    // z is 1 for the vertices that shadow_segments.hlsl pushes away from the light, to infinity.
+    v->position = Vector3(p.x, p.y, z);
+    v->color = Vector4(0, 0, 0, 0);
+    v->uv = Vector2(0, 0);
+    v->normal = Vector3(0, 0, 1);
+}
+
+static void build_light_shadow(Light_Shadow *shadow, Tilemap *tilemap, Array <Entity *> *casters) {
+    Temporary_Storage_Scope scope;
+
+    if (shadow->vertex_buffer) release_vertex_buffer(shadow->vertex_buffer);
+    shadow->vertex_buffer = NULL;
+    shadow->num_edges = 0;
+
+    Array <Shadow_Edge> edges;
+    edges.use_temporary_storage = true;
+
+    Vector2 center = shadow->center;
+    float radius = shadow->radius;
+
+    if (tilemap) {
+        Tilemap_Shadow_Edges *tile_edges = get_tilemap_shadow_edges(tilemap);
+
+        float size = (float)TILEMAP_CHUNK_SIZE;
+        int bx0 = Max((int)floorf((center.x - radius - tile_edges->origin.x) / size), 0);
+        int by0 = Max((int)floorf((center.y - radius - tile_edges->origin.y) / size), 0);
+        int bx1 = Min((int)floorf((center.x + radius - tile_edges->origin.x) / size), tile_edges->num_buckets_x - 1);
+        int by1 = Min((int)floorf((center.y + radius - tile_edges->origin.y) / size), tile_edges->num_buckets_y - 1);
+
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                for (Shadow_Edge &edge : tile_edges->buckets[by * tile_edges->num_buckets_x + bx]) {
+                    if (edge_casts_shadow(&edge, center, radius)) edges.add(edge);
+                }
+            }
+        }
+    }
+
+    Array <Shadow_Edge> box_edges;
+    box_edges.use_temporary_storage = true;
+    for (Entity *e : *casters) {
+        box_edges.clear();
+        add_box_edges(&box_edges, e->position(), e->position() + e->size());
+        for (Shadow_Edge &edge : box_edges) {
+            if (edge_casts_shadow(&edge, center, radius)) edges.add(edge);
+        }
+    }
+
+    shadow->num_edges = edges.count;
+    if (!edges.count) return;
+
+    Array <Vertex_XCUN> vertices;
+    vertices.use_temporary_storage = true;
+    vertices.resize(edges.count * 6);
+
+    for (int i = 0; i < edges.count; i++) {
+        Shadow_Edge *edge = &edges[i];
+        Vertex_XCUN *v = &vertices[i * 6];
+
+        put_shadow_vertex(&v[0], edge->a, 0.0f);
+        put_shadow_vertex(&v[1], edge->b, 0.0f);
+        put_shadow_vertex(&v[2], edge->b, 1.0f);
+
+        put_shadow_vertex(&v[3], edge->a, 0.0f);
+        put_shadow_vertex(&v[4], edge->b, 1.0f);
+        put_shadow_vertex(&v[5], edge->a, 1.0f);
+    }
+
+    shadow->vertex_buffer = create_vertex_buffer(RENDER_VERTEX_XCUN, vertices.data, vertices.count);
+}
+
+Light_Shadow *get_light_shadow(Entity_Manager *manager, Light_Source *source, Vector2 center) {
+    Temporary_Storage_Scope scope;
+
+    // Handles are per manager, and a different level can hand out the same ones.
+    u64 key = hash((void *)manager) ^ (u64)source->handle.value;
+
+    Light_Shadow *shadow = NULL;
+    Light_Shadow **found = light_shadow_lookup.find(key);
+    if (found) {
+        shadow = *found;
+    } else {
+        shadow = new Light_Shadow();
+        shadow->key = key;
+        light_shadows.add(shadow);
+        light_shadow_lookup.add(key, shadow);
+    }
+    shadow->last_frame_used = shadow_frame_index;
+
+    Array <Entity *> casters;
+    casters.use_temporary_storage = true;
+    {
+        Array <Entity *> found_entities;
+        found_entities.use_temporary_storage = true;
+        manager->grid.query_radius(center, source->radius, &found_entities);
+
+        for (Entity *e : found_entities) {
+            if (casts_shadow(e)) casters.add(e);
+        }
+    }
+
+    Tilemap *tilemap = manager->tilemap;
+    u32 collision_generation = tilemap ? tilemap->collision_generation : 0;
+    Vector2 tilemap_origin = tilemap ? tilemap->position() : Vector2(0, 0);
+    u64 casters_checksum = get_casters_checksum(&casters);
+
+    bool out_of_date = !found;
+    out_of_date = out_of_date || shadow->center.x != center.x || shadow->center.y != center.y || shadow->radius != source->radius;
+    out_of_date = out_of_date || shadow->collision_generation != collision_generation;
+    out_of_date = out_of_date || shadow->tilemap_origin.x != tilemap_origin.x || shadow->tilemap_origin.y != tilemap_origin.y;
+    out_of_date = out_of_date || shadow->casters_checksum != casters_checksum;
+
+    if (out_of_date) {
+        shadow->center = center;
+        shadow->radius = source->radius;
+        shadow->collision_generation = collision_generation;
+        shadow->tilemap_origin = tilemap_origin;
+        shadow->casters_checksum = casters_checksum;
+
+        build_light_shadow(shadow, tilemap, &casters);
+        shadow_stats.lights_rebuilt += 1;
+    }
+
+    return shadow;
+}
+
+void end_light_shadow_frame() {
+    for (int i = 0; i < light_shadows.count; i++) {
+        Light_Shadow *shadow = light_shadows[i];
+        if (shadow->last_frame_used == shadow_frame_index) continue;
+
+        if (shadow->vertex_buffer) release_vertex_buffer(shadow->vertex_buffer);
+        light_shadow_lookup.remove(shadow->key);
+        delete shadow;
+
+        light_shadows.unordered_remove_by_index(i);
+        i--;
+    }
+
+    shadow_frame_index += 1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "array.h"
+#include "geometry.h"
+
+struct Tilemap;
+struct Entity_Manager;
+struct Light_Source;
+struct Vertex_Buffer;
+
+//
+// Shadows are drawn into the alpha of the lightmap, like todo.txt describes: for every light
+// that has something in its radius, shadow_segments.hlsl zeroes the alpha behind each occluder
+// edge, the light gets drawn weighted by that alpha, and the alpha gets cleared back to 1.
+//
+// The occluders are the outlines of the tilemap's collidable tiles, merged into runs, and the
+// boxes of entities that cast shadows (trees). Only edges that face away from the light get a
+// shadow quad, so occluders light up on the side the light is on.
+//
+// A light's shadow quads go into a vertex buffer that is kept until the light moves or grows,
+// or something that casts a shadow into it changes. A light that stays put costs a spatial
+// grid query per frame to check that, and nothing else.
+//
+
+// One side of an occluder. normal points out of it.
+struct Shadow_Edge {
+    Vector2 a;
+    Vector2 b;
+    Vector2 normal;
+};
+
+// The collidable tiles' outlines, bucketed by TILEMAP_CHUNK_SIZE tiles so that a light only
+// looks at the edges near it. Runs get merged within a bucket.
+struct Tilemap_Shadow_Edges {
+    u32 collision_generation = 0; // What the edges were built from.
+    Vector2 origin;
+
+    int num_buckets_x = 0;
+    int num_buckets_y = 0;
+    Array <Shadow_Edge> *buckets = NULL;
+};
+
+struct Light_Shadow {
+    u64 key = 0; // See get_light_shadow.
+
+    // What the vertex buffer was built for.
+    Vector2 center;
+    float radius = 0.0f;
+    u32 collision_generation = 0;
+    Vector2 tilemap_origin;
+    u64 casters_checksum = 0;
+
+    Vertex_Buffer *vertex_buffer = NULL; // NULL if nothing casts a shadow into the light.
+    int num_edges = 0;
+
+    u32 last_frame_used = 0;
+};
+
+struct Shadow_Stats {
+    int lights_with_shadows = 0;
+    int lights_rebuilt = 0;
+    int edges_drawn = 0;
+};
+
+extern Shadow_Stats shadow_stats;
+
+// The light's shadow at center, built again if it is out of date. Its vertex buffer is drawn
+// with shader_shadow_segments, with global_parameters.light_position set to center.
+Light_Shadow *get_light_shadow(Entity_Manager *manager, Light_Source *source, Vector2 center);
+
+// Releases the shadows of lights that get_light_shadow wasn't called for since the last call.
+void end_light_shadow_frame();
+
+void release_tilemap_shadow_edges(Tilemap *tilemap);
@@ -0,0 +1,296 @@
+#include "pch.h"
+#include "spatial_grid.h"
+#include "entities.h"
+#include "entity_manager.h"
+
+#include <math.h>
+
+static inline u64 cell_key(int x, int y) {
+    return ((u64)(u32)x << 32) | (u64)(u32)y;
+}
+
+static inline int cell_coordinate(Spatial_Grid *grid, float v) {
+    return (int)floorf(v / grid->cell_size);
+}
+
+static float distance_squared_to_aabb(Vector2 point, Vector2 min, Vector2 max) {
+    float dx = 0.0f;
+    if (point.x < min.x) dx = min.x - point.x;
+    else if (point.x > max.x) dx = point.x - max.x;
+
+    float dy = 0.0f;
+    if (point.y < min.y) dy = min.y - point.y;
+    else if (point.y > max.y) dy = point.y - max.y;
+
+    return dx*dx + dy*dy;
+}
+
+Spatial_Grid::~Spatial_Grid() {
+    for (int i = 0; i < cells.allocated; i++) {
+        if (cells.control[i] != HASH_TABLE_EMPTY) cell_pool.release(cells.buckets[i].value);
+    }
+    cells.deinit();
+}
+
+static void add_to_cells(Spatial_Grid *grid, Entity *e, Spatial_Grid_Item *item) {
+    if (item->is_big) {
+        grid->big_entities.add(e);
+        return;
+    }
+
+    for (int y = item->y0; y <= item->y1; y++) {
+        for (int x = item->x0; x <= item->x1; x++) {
+            bool added = false;
+            auto bucket = grid->cells.find_or_add_bucket(cell_key(x, y), &added);
+            if (added) bucket->value = grid->cell_pool.get();
+            bucket->value->entities.add(e);
+        }
+    }
+
+    if (grid->max_x < grid->min_x) {
+        grid->min_x = item->x0;
+        grid->min_y = item->y0;
+        grid->max_x = item->x1;
+        grid->max_y = item->y1;
+    } else {
+        grid->min_x = Min(grid->min_x, item->x0);
+        grid->min_y = Min(grid->min_y, item->y0);
+        grid->max_x = Max(grid->max_x, item->x1);
+        grid->max_y = Max(grid->max_y, item->y1);
+    }
+}
+
+static void remove_from_array(Array <Entity *> *array, Entity *e) {
+    int index = array->find(e);
+    if (index != -1) array->unordered_remove_by_index(index);
+}
+
+static void remove_from_cells(Spatial_Grid *grid, Entity *e, Spatial_Grid_Item *item) {
+    if (item->is_big) {
+        remove_from_array(&grid->big_entities, e);
+        return;
+    }
+
+    for (int y = item->y0; y <= item->y1; y++) {
+        for (int x = item->x0; x <= item->x1; x++) {
+            Spatial_Grid_Cell **cell = grid->cells.find(cell_key(x, y));
+            if (cell) remove_from_array(&(*cell)->entities, e);
+        }
+    }
+}
+
+void Spatial_Grid::update(Entity *e, Vector2 position, Vector2 size) {
+    int slot = (int)e->handle.get_index();
+    if (slot >= items.count) items.resize(slot + 1);
+
+    int x0 = cell_coordinate(this, position.x);
+    int y0 = cell_coordinate(this, position.y);
+    int x1 = cell_coordinate(this, position.x + size.x);
+    int y1 = cell_coordinate(this, position.y + size.y);
+    bool is_big = (s64)(x1 - x0 + 1) * (s64)(y1 - y0 + 1) > SPATIAL_GRID_MAX_CELLS_PER_ENTITY;
+
+    Spatial_Grid_Item *item = &items[slot];
+    if (item->entity == e) {
+        if (item->is_big && is_big) return;
+        if (item->x0 == x0 && item->y0 == y0 && item->x1 == x1 && item->y1 == y1) return;
+        remove_from_cells(this, e, item);
+    }
+
+    item->entity = e;
+    item->is_big = is_big;
+    item->x0 = x0;
+    item->y0 = y0;
+    item->x1 = x1;
+    item->y1 = y1;
+    add_to_cells(this, e, item);
+}
+
+void Spatial_Grid::remove(Entity *e) {
+    int slot = (int)e->handle.get_index();
+    if (slot >= items.count) return;
+
+    Spatial_Grid_Item *item = &items[slot];
+    if (item->entity != e) return;
+
+    remove_from_cells(this, e, item);
+    item->entity = NULL;
+}
+
+void Spatial_Grid::remove_empty_cells() {
+    Temporary_Storage_Scope scope;
+
+    Array <u64> empty_keys;
+    empty_keys.use_temporary_storage = true;
+
+    min_x = min_y = 0;
+    max_x = max_y = -1;
+    bool first = true;
+
+    for (int i = 0; i < cells.allocated; i++) {
+        if (cells.control[i] == HASH_TABLE_EMPTY) continue;
+
+        auto bucket = &cells.buckets[i];
+        if (!bucket->value->entities.count) {
+            empty_keys.add(bucket->key);
+            continue;
+        }
+
+        int x = (int)(s32)(u32)(bucket->key >> 32);
+        int y = (int)(s32)(u32)bucket->key;
+        if (first) {
+            min_x = max_x = x;
+            min_y = max_y = y;
+            first = false;
+        } else {
+            min_x = Min(min_x, x);
+            min_y = Min(min_y, y);
+            max_x = Max(max_x, x);
+            max_y = Max(max_y, y);
+        }
+    }
+
+    for (u64 key : empty_keys) {
+        Spatial_Grid_Cell **cell = cells.find(key);
+        cell_pool.release(*cell);
+        cells.remove(key);
+    }
+
+    cell_pool.release_empty_slabs();
+}
+
+static u32 next_query_stamp(Spatial_Grid *grid) {
+    grid->query_stamp += 1;
+    if (!grid->query_stamp) {
+        for (Spatial_Grid_Item &item : grid->items) item.query_stamp = 0;
+        grid->query_stamp = 1;
+    }
+    return grid->query_stamp;
+}
+
+// True the first time e is seen during the current query.
+static inline bool visit(Spatial_Grid *grid, Entity *e) {
+    Spatial_Grid_Item *item = &grid->items[e->handle.get_index()];
+    if (item->query_stamp == grid->query_stamp) return false;
+    item->query_stamp = grid->query_stamp;
+    return true;
+}
+
+// Calls proc on every entity in cells overlapping min..max, once per entity.
+template <typename Proc>
+static void for_each_candidate(Spatial_Grid *grid, Vector2 min, Vector2 max, Proc proc) {
+    next_query_stamp(grid);
+
+    for (Entity *e : grid->big_entities) proc(e);
+
+    int x0 = Max(cell_coordinate(grid, min.x), grid->min_x);
+    int y0 = Max(cell_coordinate(grid, min.y), grid->min_y);
+    int x1 = Min(cell_coordinate(grid, max.x), grid->max_x);
+    int y1 = Min(cell_coordinate(grid, max.y), grid->max_y);
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            Spatial_Grid_Cell **cell = grid->cells.find(cell_key(x, y));
+            if (!cell) continue;
+
+            for (Entity *e : (*cell)->entities) {
+                if (visit(grid, e)) proc(e);
+            }
+        }
+    }
+}
+
+void Spatial_Grid::query_point(Vector2 point, Array <Entity *> *results) {
+    query_aabb(point, point, results);
+}
+
+void Spatial_Grid::query_aabb(Vector2 min, Vector2 max, Array <Entity *> *results) {
+    for_each_candidate(this, min, max, [&](Entity *e) {
+        Vector2 p = e->position();
+        Vector2 s = e->size();
+        if (p.x > max.x || p.y > max.y || p.x + s.x < min.x || p.y + s.y < min.y) return;
+        results->add(e);
+    });
+}
+
+void Spatial_Grid::query_radius(Vector2 center, float radius, Array <Entity *> *results) {
+    Vector2 min(center.x - radius, center.y - radius);
+    Vector2 max(center.x + radius, center.y + radius);
+
+    for_each_candidate(this, min, max, [&](Entity *e) {
+        Vector2 p = e->position();
+        if (distance_squared_to_aabb(center, p, p + e->size()) > radius*radius) return;
+        results->add(e);
+    });
+}
+
+int Spatial_Grid::query_nearest(Vector2 point, int k, Entity **results) {
+    if (k <= 0) return 0;
+
+    Temporary_Storage_Scope scope;
+    float *distances = (float *)talloc(k * sizeof(float));
+    int count = 0;
+
+    auto consider = [&](Entity *e) {
+        Vector2 p = e->position();
+        float d = distance_squared_to_aabb(point, p, p + e->size());
+        if (count == k && d >= distances[k-1]) return;
+
+        // Insertion into the sorted list of the best k so far.
+        int i = (count < k) ? count++ : k-1;
+        while (i > 0 && distances[i-1] > d) {
+            distances[i] = distances[i-1];
+            results[i] = results[i-1];
+            i--;
+        }
+        distances[i] = d;
+        results[i] = e;
+    };
+
+    next_query_stamp(this);
+    for (Entity *e : big_entities) consider(e);
+
+    if (max_x < min_x) return count;
+
+    int hx = cell_coordinate(this, point.x);
+    int hy = cell_coordinate(this, point.y);
+
+    // Rings closer than the occupied bounds are empty, so start at the first one that isn't.
+    int dx = Max(Max(min_x - hx, hx - max_x), 0);
+    int dy = Max(Max(min_y - hy, hy - max_y), 0);
+    int max_ring = Max(Max(hx - min_x, max_x - hx), Max(hy - min_y, max_y - hy));
+
+    auto scan_cell = [&](int x, int y) {
+        if (x < min_x || x > max_x || y < min_y || y > max_y) return;
+
+        Spatial_Grid_Cell **cell = cells.find(cell_key(x, y));
+        if (!cell) return;
+
+        for (Entity *e : (*cell)->entities) {
+            if (visit(this, e)) consider(e);
+        }
+    };
+
+    for (int r = Max(dx, dy); r <= max_ring; r++) {
+        // Every cell of ring r is at least r-1 cells away from point.
+        if (count == k && r > 0) {
+            float ring_distance = (r - 1) * cell_size;
+            if (distances[k-1] <= ring_distance*ring_distance) break;
+        }
+
+        if (r == 0) {
+            scan_cell(hx, hy);
+            continue;
+        }
+
+        for (int x = hx - r; x <= hx + r; x++) {
+            scan_cell(x, hy - r);
+            scan_cell(x, hy + r);
+        }
+        for (int y = hy - r + 1; y <= hy + r - 1; y++) {
+            scan_cell(hx - r, y);
+            scan_cell(hx + r, y);
+        }
+    }
+
+    return count;
+}
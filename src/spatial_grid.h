@@ -0,0 +1,63 @@
+#pragma once
+
+#include "array.h"
+#include "hash_table.h"
+#include "pool.h"
+#include "geometry.h"
+
+struct Entity;
+
+//
+// Uniform grid over entity AABBs (position to position + size). Only cells that hold
+// something exist, they live in a hash table keyed on the packed cell coordinates.
+//
+// An entity is in every cell its AABB touches, unless that is more than
+// SPATIAL_GRID_MAX_CELLS_PER_ENTITY cells, in which case it goes on a list that every
+// query checks. Queries report each entity once.
+//
+
+const float SPATIAL_GRID_DEFAULT_CELL_SIZE = 2.0f;
+const int SPATIAL_GRID_MAX_CELLS_PER_ENTITY = 64;
+
+struct Spatial_Grid_Cell {
+    Array <Entity *> entities;
+};
+
+struct Spatial_Grid_Item {
+    Entity *entity = NULL;
+    bool is_big = false;
+    int x0 = 0, y0 = 0;
+    int x1 = 0, y1 = 0;
+    u32 query_stamp = 0;
+};
+
+struct Spatial_Grid {
+    float cell_size = SPATIAL_GRID_DEFAULT_CELL_SIZE;
+
+    Hash_Table <u64, Spatial_Grid_Cell *> cells;
+    Pool <Spatial_Grid_Cell> cell_pool;
+    Array <Entity *> big_entities;
+
+    // Indexed by the slot index of the entity's handle.
+    Array <Spatial_Grid_Item> items;
+    u32 query_stamp = 0;
+
+    // Bounds of every cell that was ever used, for k-nearest queries to know when to stop.
+    int min_x = 0, min_y = 0;
+    int max_x = -1, max_y = -1;
+
+    ~Spatial_Grid();
+
+    // Inserts e, or moves it if its AABB now touches different cells.
+    void update(Entity *e, Vector2 position, Vector2 size);
+    void remove(Entity *e);
+    void remove_empty_cells();
+
+    // Queries add what they find to results.
+    void query_point(Vector2 point, Array <Entity *> *results);
+    void query_aabb(Vector2 min, Vector2 max, Array <Entity *> *results);
+    void query_radius(Vector2 center, float radius, Array <Entity *> *results);
+
+    // Fills results with up to k entities, closest AABB first, and returns how many it found.
+    int query_nearest(Vector2 point, int k, Entity **results);
+};
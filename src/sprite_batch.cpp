@@ -0,0 +1,223 @@
+#include "pch.h"
+#include "sprite_batch.h"
+#include "render.h"
+#include "texture_registry.h"
+
+// The radix sort only looks at the bits above the index: the keys go in in index order and
+// every pass is stable, so sprites with equal keys stay in the order they were added.
+const int RADIX_DIGIT_BITS = 11;
+const int RADIX_NUM_BUCKETS = 1 << RADIX_DIGIT_BITS;
+const int RADIX_NUM_PASSES = (64 - SPRITE_KEY_INDEX_BITS + RADIX_DIGIT_BITS - 1) / RADIX_DIGIT_BITS;
+
+Sprite_Sort_Stats sprite_sort_stats;
+
+static void radix_sort(u64 *keys, u64 *scratch, int count) {
+    static int histograms[RADIX_NUM_PASSES][RADIX_NUM_BUCKETS];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (int i = 0; i < count; i++) {
+        u64 key = keys[i] >> SPRITE_KEY_INDEX_BITS;
+        for (int pass = 0; pass < RADIX_NUM_PASSES; pass++) {
+            histograms[pass][(key >> (pass * RADIX_DIGIT_BITS)) & (RADIX_NUM_BUCKETS - 1)] += 1;
+        }
+    }
+
+    u64 *source = keys;
+    u64 *dest = scratch;
+    for (int pass = 0; pass < RADIX_NUM_PASSES; pass++) {
+        int shift = SPRITE_KEY_INDEX_BITS + pass * RADIX_DIGIT_BITS;
+        int *histogram = histograms[pass];
+
+        // Usually true for the layer and the shader bits: every key has the same digit.
+        if (histogram[(source[0] >> shift) & (RADIX_NUM_BUCKETS - 1)] == count) continue;
+
+        int offset = 0;
+        for (int i = 0; i < RADIX_NUM_BUCKETS; i++) {
+            int bucket_count = histogram[i];
+            histogram[i] = offset;
+            offset += bucket_count;
+        }
+
+        for (int i = 0; i < count; i++) {
+            u64 key = source[i];
+            dest[histogram[(key >> shift) & (RADIX_NUM_BUCKETS - 1)]++] = key;
+        }
+
+        u64 *temp = source;
+        source = dest;
+        dest = temp;
+    }
+
+    if (source != keys) memcpy(keys, source, count * sizeof(u64));
+}
+
+// Sorts keys that are nearly in order already, as long as that takes at most max_moves moves.
+// Returns false, with the keys in no particular order, if it would take more. Keys are unique
+// (they end in the index), so this orders them the same as radix_sort.
+static bool insertion_sort(u64 *keys, int count, s64 max_moves) {
+    s64 num_moves = 0;
+    bool sorted = true;
+
+    for (int i = 1; i < count; i++) {
+        u64 key = keys[i];
+        if (keys[i - 1] < key) continue;
+
+        int j = i;
+        while (j > 0 && keys[j - 1] > key) {
+            keys[j] = keys[j - 1];
+            j -= 1;
+            num_moves += 1;
+        }
+        keys[j] = key;
+
+        if (num_moves > max_moves) {
+            sorted = false;
+            break;
+        }
+    }
+
+    sprite_sort_stats.keys_moved += num_moves;
+    return sorted;
+}
+
+// The whole add, for when add's shortcut doesn't apply.
+Sprite_Instance *Sprite_Batch::add_with_lookup(int layer, float depth, Shader *shader, Texture *texture) {
+    assert(layer >= 0 && layer < SPRITE_MAX_LAYERS);
+
+    if (sprites.count >= SPRITE_MAX_SPRITES) draw();
+
+    int shader_index = last_shader_index;
+    if (shader_index < 0 || shader != last_shader) {
+        shader_index = shaders.find(shader);
+        if (shader_index == -1) {
+            if (shaders.count >= SPRITE_MAX_SHADERS) draw();
+            shader_index = shaders.count;
+            shaders.add(shader);
+        }
+
+        last_shader = shader;
+        last_shader_index = shader_index;
+    }
+
+    int texture_index = last_texture_index;
+    if (texture_index < 0 || texture != last_texture) {
+        int *_texture_index = texture_indices.find(texture);
+        if (_texture_index) {
+            texture_index = *_texture_index;
+        } else {
+            if (textures.count >= SPRITE_MAX_TEXTURES) {
+                draw();
+                shader_index = 0;
+                shaders.add(shader);
+
+                last_shader = shader;
+                last_shader_index = shader_index;
+            }
+            texture_index = textures.count;
+            textures.add(texture);
+            texture_indices.add(texture, texture_index);
+        }
+
+        last_texture = texture;
+        last_texture_index = texture_index;
+    }
+
+    u64 key_bits = (u64)layer << SPRITE_KEY_LAYER_SHIFT;
+    key_bits |= (u64)shader_index << SPRITE_KEY_SHADER_SHIFT;
+    key_bits |= (u64)texture_index << SPRITE_KEY_TEXTURE_SHIFT;
+
+    last_layer = layer;
+    last_key_bits = key_bits;
+
+    keys.add(key_bits | (get_sprite_depth_bits(depth) << SPRITE_KEY_DEPTH_SHIFT) | (u64)sprites.count);
+
+    return sprites.add();
+}
+
+void Sprite_Batch::add(int layer, float depth, Shader *shader, Texture *texture, Vector2 position, Vector2 size, Vector2 uv0, Vector2 uv1, Vector4 color) {
+    Sprite_Instance *sprite = add(layer, depth, shader, texture);
+    put_sprite_instance(sprite, position, size, uv0, uv1, pack_rgba8(color));
+}
+
+void Sprite_Batch::add(int layer, float depth, Shader *shader, Texture_Region *region, Vector2 position, Vector2 size, Vector4 color) {
+    add(layer, depth, shader, region->texture, position, size, region->uv0, region->uv1, color);
+}
+
+void Sprite_Batch::reserve(int num_more_sprites) {
+    int count = Min(sprites.count + num_more_sprites, SPRITE_MAX_SPRITES);
+    sprites.reserve(count);
+    keys.reserve(count);
+}
+
+// Returns the keys in the order to draw them.
+static u64 *sort_keys(Sprite_Batch *batch) {
+    int count = batch->keys.count;
+    batch->sorted_keys.resize(count);
+    u64 *sorted = batch->sorted_keys.data;
+
+    if (batch->previous_order.count == count) {
+        for (int i = 0; i < count; i++) sorted[i] = batch->keys[batch->previous_order[i]];
+
+        if (insertion_sort(sorted, count, count)) {
+            sprite_sort_stats.incremental_sorts += 1;
+            return sorted;
+        }
+    }
+
+    memcpy(sorted, batch->keys.data, count * sizeof(u64));
+    batch->sort_scratch.resize(count);
+    radix_sort(sorted, batch->sort_scratch.data, count);
+
+    sprite_sort_stats.radix_sorts += 1;
+    return sorted;
+}
+
+static u64 get_shader_and_texture_bits(u64 key) {
+    return (key >> SPRITE_KEY_TEXTURE_SHIFT) & ((1 << (SPRITE_KEY_SHADER_BITS + SPRITE_KEY_TEXTURE_BITS)) - 1);
+}
+
+void Sprite_Batch::draw() {
+    if (sprites.count) {
+        u64 *sorted = sort_keys(this);
+
+        // Every run of the same shader and texture is one draw. Its sprites get laid out in
+        // the sorted order right where the recorded frame keeps them.
+        previous_order.resize(sprites.count);
+
+        int run_start = 0;
+        while (run_start < keys.count) {
+            u64 run_bits = get_shader_and_texture_bits(sorted[run_start]);
+            int run_end = run_start + 1;
+            while (run_end < keys.count && get_shader_and_texture_bits(sorted[run_end]) == run_bits) run_end += 1;
+
+            Shader *shader = shaders[(int)(run_bits >> SPRITE_KEY_TEXTURE_BITS)];
+            Texture *texture = textures[(int)(run_bits & (SPRITE_MAX_TEXTURES - 1))];
+
+            set_shader(shader);
+            if (texture) set_texture(0, texture);
+
+            Sprite_Instance *dest = draw_sprite_instances(run_end - run_start);
+            for (int i = run_start; i < run_end; i++) {
+                int index = (int)(sorted[i] & (SPRITE_MAX_SPRITES - 1));
+                dest[i - run_start] = sprites[index];
+                previous_order[i] = index;
+            }
+
+            run_start = run_end;
+        }
+    } else {
+        previous_order.clear();
+    }
+
+    sprites.clear();
+    keys.clear();
+    shaders.clear();
+    textures.clear();
+    texture_indices.reset();
+
+    last_layer = -1;
+    last_shader = NULL;
+    last_shader_index = -1;
+    last_texture = NULL;
+    last_texture_index = -1;
+}
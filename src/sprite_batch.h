@@ -0,0 +1,116 @@
+#pragma once
+
+#include "array.h"
+#include "hash_table.h"
+#include "geometry.h"
+#include "render_vertex.h"
+
+struct Shader;
+struct Texture;
+struct Texture_Region;
+
+//
+// Collects the sprites of a frame and draws them all at once: sorted by a 64-bit key and
+// flushed only when the shader or the texture changes. From the top bit down the key is
+//
+//     layer (4 bits) | depth (24 bits) | shader (6 bits) | texture (10 bits) | index (20 bits)
+//
+// Lower layers are drawn first. Within a layer, sprites with a bigger depth are drawn first
+// (they are farther away), and sprites with the same depth are grouped by shader and texture.
+// Sprites with equal keys are drawn in the order they were added.
+//
+// The shader and texture bits are indices into per-batch tables, not pointers, so a batch
+// can use up to 64 shaders and 1024 textures. If it needs more, or more sprites than fit in
+// the index bits, the sprites added so far get drawn early.
+//
+// Sorting starts from the order the last draw ended up in, when it drew as many sprites: from
+// one frame to the next, sprites mostly get added in the same order and keep their depths, so
+// an insertion sort from there only has a few keys to move. When it would have to move more
+// than there are sprites, the keys get radix sorted instead. Either way the order comes out the
+// same, and the sort is O(n).
+//
+// Sprites are kept as the Sprite_Instances they get drawn with, one draw_sprite_instances per
+// run of the same shader and texture, so their shaders need VertexType = "Sprite_Instance".
+//
+
+const int SPRITE_MAX_LAYERS = 16;
+
+const int SPRITE_KEY_INDEX_BITS = 20;
+const int SPRITE_KEY_TEXTURE_BITS = 10;
+const int SPRITE_KEY_SHADER_BITS = 6;
+const int SPRITE_KEY_DEPTH_BITS = 24;
+
+const int SPRITE_KEY_TEXTURE_SHIFT = SPRITE_KEY_INDEX_BITS;
+const int SPRITE_KEY_SHADER_SHIFT = SPRITE_KEY_TEXTURE_SHIFT + SPRITE_KEY_TEXTURE_BITS;
+const int SPRITE_KEY_DEPTH_SHIFT = SPRITE_KEY_SHADER_SHIFT + SPRITE_KEY_SHADER_BITS;
+const int SPRITE_KEY_LAYER_SHIFT = SPRITE_KEY_DEPTH_SHIFT + SPRITE_KEY_DEPTH_BITS;
+
+const int SPRITE_MAX_SPRITES = 1 << SPRITE_KEY_INDEX_BITS;
+const int SPRITE_MAX_TEXTURES = 1 << SPRITE_KEY_TEXTURE_BITS;
+const int SPRITE_MAX_SHADERS = 1 << SPRITE_KEY_SHADER_BITS;
+
+// Orders floats like unsigned ints, biggest depth first, and keeps the top SPRITE_KEY_DEPTH_BITS.
+inline u64 get_sprite_depth_bits(float depth) {
+    u32 bits;
+    memcpy(&bits, &depth, sizeof(bits));
+
+    if (bits & 0x80000000) bits = ~bits;
+    else bits |= 0x80000000;
+
+    return (u64)(~bits >> (32 - SPRITE_KEY_DEPTH_BITS));
+}
+
+// Counted by Sprite_Batch::draw, for the HUD and the headless runner to show.
+struct Sprite_Sort_Stats {
+    int incremental_sorts = 0; // Insertion sorts from the previous order.
+    int radix_sorts = 0;
+    s64 keys_moved = 0; // By the insertion sorts, including the ones that gave up.
+};
+
+extern Sprite_Sort_Stats sprite_sort_stats;
+
+struct Sprite_Batch {
+    Array <Sprite_Instance> sprites; // In the order they were added.
+    Array <u64> keys;
+    Array <u64> sorted_keys;
+    Array <u64> sort_scratch;
+    Array <int> previous_order; // Indices of the sprites the last draw drew, in the order it drew them.
+
+    Array <Shader *> shaders;
+    Array <Texture *> textures;
+    Hash_Table <Texture *, int> texture_indices;
+
+    // Most sprites use the same layer, shader and texture as the one before them.
+    int last_layer = -1;
+    Shader *last_shader = NULL;
+    int last_shader_index = -1;
+    Texture *last_texture = NULL;
+    int last_texture_index = -1;
+    u64 last_key_bits = 0; // The layer, shader and texture bits of the last key.
+
+    // Returns the sprite's instance for the caller to fill in, see put_sprite_instance.
+    Sprite_Instance *add(int layer, float depth, Shader *shader, Texture *texture);
+    Sprite_Instance *add_with_lookup(int layer, float depth, Shader *shader, Texture *texture);
+    
+    void add(int layer, float depth, Shader *shader, Texture *texture, Vector2 position, Vector2 size, Vector2 uv0, Vector2 uv1, Vector4 color);
+    void add(int layer, float depth, Shader *shader, Texture_Region *region, Vector2 position, Vector2 size, Vector4 color);
+
+    void reserve(int num_more_sprites); // Room for this many more adds without growing the arrays.
+
+    // Sorts and draws everything added since the last draw, then empties the batch. The caller
+    // sets up the render targets and global parameters.
+    void draw();
+};
+
+// Inline, because it runs for every sprite: with the same layer, shader and texture as the
+// sprite before and room reserved, all there is to do is the key.
+inline Sprite_Instance *Sprite_Batch::add(int layer, float depth, Shader *shader, Texture *texture) {
+    int index = sprites.count;
+    if (layer != last_layer || shader != last_shader || texture != last_texture) return add_with_lookup(layer, depth, shader, texture);
+    if (index >= sprites.allocated || index >= keys.allocated || index >= SPRITE_MAX_SPRITES) return add_with_lookup(layer, depth, shader, texture);
+
+    keys.data[index] = last_key_bits | (get_sprite_depth_bits(depth) << SPRITE_KEY_DEPTH_SHIFT) | (u64)index;
+    keys.count = index + 1;
+    sprites.count = index + 1;
+    return &sprites.data[index];
+}
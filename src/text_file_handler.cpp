@@ -15,7 +15,6 @@ void Text_File_Handler::start_file(char *_short_name, char *_full_path, char *_l
     log_agent = _log_agent;
 
     bool success = false;
-    char *read_entire_text_file(char *filepath);
     file_data = read_entire_text_file(full_path);
     orig_file_data = file_data;
 
@@ -78,8 +77,7 @@ char *Text_File_Handler::consume_next_line() {
 }
 
 void Text_File_Handler::report_error(char *fmt, ...) {
-    s64 mark = get_temporary_storage_mark();
-    defer { set_temporary_storage_mark(mark); };
+    Temporary_Storage_Scope temporary_scope;
     
     va_list args;
     va_start(args, fmt);
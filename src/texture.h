@@ -24,9 +24,11 @@ struct Texture {
 
     Texture_Format format = TEXTURE_FORMAT_UNKNOWN;
     int bytes_per_pixel = 0;
-    
+
+#ifdef RENDER_D3D11
     ID3D11Texture2D *texture = NULL;
     ID3D11ShaderResourceView *srv = NULL;
+#endif
 };
 
 bool load_bitmap(Bitmap *bitmap, char *filepath);
@@ -2,6 +2,9 @@
 #include "texture_registry.h"
 #include "os.h"
 #include "texture.h"
+#include "text_file_handler.h"
+
+#define ATLAS_FILE_VERSION 1
 
 Texture *Texture_Registry::get(char *name) {
     Texture **_texture = texture_lookup.find(name);
@@ -49,17 +52,160 @@ Texture *Texture_Registry::get(char *name) {
     return texture;
 }
 
-void Texture_Registry::do_hotloading() {
-    for (int i = 0; i < loaded_textures.count; i++) {
-        Texture *texture = loaded_textures[i];
+Texture_Region *Texture_Registry::get_region(char *name) {
+    Texture_Region **_region = region_lookup.find(name);
+    if (_region) return *_region;
+
+    Texture *texture = get(name);
+    if (!texture) return NULL;
+
+    Texture_Region *region = new Texture_Region();
+    region->texture = texture;
+
+    region_lookup.add(name, region);
+    return region;
+}
+
+// Reads the atlas file and (re)loads its pages. Existing pages and regions are updated in place.
+static bool load_atlas_file(Texture_Registry *registry, Texture_Atlas *atlas) {
+    registry->region_generation += 1;
+    
+    Text_File_Handler handler;
+    handler.start_file(atlas->name, atlas->full_path, "load_atlas");
+    if (handler.failed) return false;
+
+    if (handler.version > ATLAS_FILE_VERSION) {
+        handler.report_error("Version number too high (%d), the highest we know about is %d.\n", handler.version, ATLAS_FILE_VERSION);
+        return false;
+    }
+
+    char *line = handler.consume_next_line();
+    if (!line || !starts_with(line, "num_pages")) {
+        handler.report_error("num_pages is missing.\n");
+        return false;
+    }
+    int num_pages = atoi(eat_spaces(line + 9));
+
+    for (int i = 0; i < num_pages; i++) {
+        line = handler.consume_next_line();
+
+        int page_width = 0, page_height = 0, name_offset = 0;
+        if (!line || sscanf(line, "page %d %d %n", &page_width, &page_height, &name_offset) != 2 || !name_offset) {
+            handler.report_error("Expected 'page <width> <height> <filename>'.\n");
+            return false;
+        }
+
+        char *filename = eat_trailing_spaces(line + name_offset);
+        char *full_path = tprint("%s/%s", ATLAS_DIRECTORY, filename);
+
+        bool is_new_page = i >= atlas->pages.count;
+        Texture *page = is_new_page ? new Texture() : atlas->pages[i];
+        if (!load_texture_from_file(page, full_path)) {
+            handler.report_error("Unable to load atlas page '%s'.\n", full_path);
+            if (is_new_page) delete page;
+            return false;
+        }
+
+        if (page->width != page_width || page->height != page_height) {
+            handler.report_error("Atlas page '%s' is %dx%d, but the atlas says %dx%d.\n", full_path, page->width, page->height, page_width, page_height);
+        }
+
+        delete [] page->full_path;
+        delete [] page->name;
+        page->full_path = copy_string(full_path);
+        page->name = strrchr(filename, '.') ? copy_strip_extension(filename) : copy_string(filename);
+        get_file_last_write_time(full_path, &page->modtime);
+
+        if (is_new_page) atlas->pages.add(page);
+    }
+
+    line = handler.consume_next_line();
+    if (!line || !starts_with(line, "num_regions")) {
+        handler.report_error("num_regions is missing.\n");
+        return false;
+    }
+    int num_regions = atoi(eat_spaces(line + 11));
+
+    for (int i = 0; i < num_regions; i++) {
+        line = handler.consume_next_line();
+
+        int page_index = 0, x = 0, y = 0, width = 0, height = 0, name_offset = 0;
+        if (!line || sscanf(line, "region %d %d %d %d %d %n", &page_index, &x, &y, &width, &height, &name_offset) != 5 || !name_offset) {
+            handler.report_error("Expected 'region <page> <x> <y> <width> <height> <name>'.\n");
+            return false;
+        }
+
+        if (page_index < 0 || page_index >= num_pages) {
+            handler.report_error("Region on page %d, but there are only %d pages.\n", page_index, num_pages);
+            continue;
+        }
+
+        char *name = eat_trailing_spaces(line + name_offset);
+
+        Texture_Region *region = NULL;
+        Texture_Region **_region = registry->region_lookup.find(name);
+        if (_region) {
+            region = *_region;
+        } else {
+            region = new Texture_Region();
+            registry->region_lookup.add(name, region);
+        }
+
+        // Regions are from the top left of the page, but textures get flipped when they are loaded.
+        Texture *page = atlas->pages[page_index];
+        float w = (float)page->width;
+        float h = (float)page->height;
+
+        region->texture = page;
+        region->uv0 = Vector2(x / w, (h - (y + height)) / h);
+        region->uv1 = Vector2((x + width) / w, (h - y) / h);
+    }
+
+    return true;
+}
+
+bool Texture_Registry::load_atlas(char *name) {
+    char *full_path = tprint("%s/%s.atlas", ATLAS_DIRECTORY, name);
+    if (!file_exists(full_path)) return false;
+
+    for (Texture_Atlas *atlas : loaded_atlases) {
+        if (strings_match(atlas->full_path, full_path)) return true;
+    }
+
+    Texture_Atlas *atlas = new Texture_Atlas();
+    atlas->full_path = copy_string(full_path);
+    atlas->name = copy_string(name);
+    get_file_last_write_time(full_path, &atlas->modtime);
+
+    // Kept even if it fails to load, regions may already point at its pages and a hotload can fix it.
+    loaded_atlases.add(atlas);
+
+    return load_atlas_file(this, atlas);
+}
 
-        u64 modtime = texture->modtime;
-        bool success = get_file_last_write_time(texture->full_path, &modtime);
-        if (!success) continue;
+bool Texture_Registry::hotload(char *full_path) {
+    if (starts_with(full_path, ATLAS_DIRECTORY "/")) {
+        // atlas_packer writes the pages first and the atlas last, so reloading the whole thing
+        // when the atlas changes picks up the pages too.
+        for (Texture_Atlas *atlas : loaded_atlases) {
+            if (!strings_match(atlas->full_path, full_path)) continue;
 
-        if (texture->modtime != modtime) {
-            texture->modtime = modtime;
-            load_texture_from_file(texture, texture->full_path);
+            get_file_last_write_time(full_path, &atlas->modtime);
+            load_atlas_file(this, atlas);
         }
+        return true;
     }
+
+    char *name = get_asset_name_from_path(full_path, TEXTURE_DIRECTORY);
+    if (!name) return false;
+
+    Texture **_texture = texture_lookup.find(name);
+    if (!_texture) return true;
+
+    Texture *texture = *_texture;
+    if (!strings_match(texture->full_path, full_path)) return true; // Same name, different extension.
+
+    get_file_last_write_time(full_path, &texture->modtime);
+    load_texture_from_file(texture, full_path);
+    return true;
 }
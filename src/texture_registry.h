@@ -4,13 +4,43 @@
 #include "array.h"
 
 #define TEXTURE_DIRECTORY "data/textures"
+#define ATLAS_DIRECTORY "data/atlases"
 
 struct Texture;
 
+// Where a named image lives: a rectangle of an atlas page, or all of a texture of its own.
+struct Texture_Region {
+    Texture *texture = NULL;
+    Vector2 uv0 = Vector2(0, 0); // Bottom left.
+    Vector2 uv1 = Vector2(1, 1); // Top right.
+};
+
+// Pages and metadata written by atlas_packer (see atlas_packer.cpp).
+struct Texture_Atlas {
+    char *full_path = NULL;
+    char *name = NULL;
+    u64 modtime = 0;
+
+    Array <Texture *> pages;
+};
+
 struct Texture_Registry {
     String_Hash_Table <Texture *> texture_lookup;
     Array <Texture *> loaded_textures;
-    
+
+    // Regions never move once they are handed out, hotloading updates them in place.
+    String_Hash_Table <Texture_Region *> region_lookup;
+    Array <Texture_Atlas *> loaded_atlases;
+    u32 region_generation = 0; // Bumped whenever an atlas (re)loads, for things that copied uvs out of regions.
+
     Texture *get(char *name);
-    void do_hotloading();
+
+    // Looks in the loaded atlases first, and falls back to get(name) for images that weren't packed.
+    Texture_Region *get_region(char *name);
+
+    // Loads ATLAS_DIRECTORY/name.atlas. Returns false if there is no such atlas.
+    bool load_atlas(char *name);
+
+    // Reloads the texture or atlas at full_path if it was loaded. Returns false for paths outside TEXTURE_DIRECTORY and ATLAS_DIRECTORY.
+    bool hotload(char *full_path);
 };
@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "tilemap_collision.h"
+#include "entities.h"
+
+#include <math.h>
+
+static u32 next_collision_generation = 1;
+
+void build_tilemap_collision_bits(Tilemap *tilemap, bool *is_collidable) {
+    tilemap->collision_generation = next_collision_generation++;
+
+    int words_per_row = (tilemap->width + 63) / 64;
+    s64 num_words = (s64)words_per_row * tilemap->height;
+
+    delete [] tilemap->collision_bits;
+    tilemap->collision_bits = new u64[num_words];
+    tilemap->collision_words_per_row = words_per_row;
+    memset(tilemap->collision_bits, 0, num_words * sizeof(u64));
+
+    for (int y = 0; y < tilemap->height; y++) {
+        u64 *row = tilemap->collision_bits + (s64)y * words_per_row;
+        for (int x = 0; x < tilemap->width; x++) {
+            if (is_collidable[(s64)y * tilemap->width + x]) row[x / 64] |= 1ULL << (x % 64);
+        }
+    }
+}
+
+bool is_tile_collidable(Tilemap *tilemap, int x, int y) {
+    if (x < 0 || y < 0 || x >= tilemap->width || y >= tilemap->height) return false;
+    u64 word = tilemap->collision_bits[(s64)y * tilemap->collision_words_per_row + x / 64];
+    return (word >> (x % 64)) & 1;
+}
+
+Tile_Range get_overlapped_tile_range(Tilemap *tilemap, c2AABB aabb) {
+    float min_x = aabb.min.x - tilemap->position().x;
+    float min_y = aabb.min.y - tilemap->position().y;
+    float max_x = aabb.max.x - tilemap->position().x;
+    float max_y = aabb.max.y - tilemap->position().y;
+
+    // Tiles that only share an edge with aabb count, c2AABBtoAABBManifold reports those too.
+    Tile_Range range;
+    range.x0 = Max((int)ceilf(min_x - 1.0f), 0);
+    range.y0 = Max((int)ceilf(min_y - 1.0f), 0);
+    range.x1 = Min((int)floorf(max_x), tilemap->width - 1);
+    range.y1 = Min((int)floorf(max_y), tilemap->height - 1);
+    return range;
+}
+
+bool tile_range_has_collision(Tilemap *tilemap, Tile_Range range) {
+    if (range.x1 < range.x0 || range.y1 < range.y0) return false;
+
+    int first_word = range.x0 / 64;
+    int last_word = range.x1 / 64;
+    u64 first_mask = ~0ULL << (range.x0 % 64);
+    u64 last_mask = ~0ULL >> (63 - range.x1 % 64);
+
+    for (int y = range.y0; y <= range.y1; y++) {
+        u64 *row = tilemap->collision_bits + (s64)y * tilemap->collision_words_per_row;
+        for (int w = first_word; w <= last_word; w++) {
+            u64 mask = ~0ULL;
+            if (w == first_word) mask &= first_mask;
+            if (w == last_word) mask &= last_mask;
+            if (row[w] & mask) return true;
+        }
+    }
+
+    return false;
+}
+
+void resolve_tile_collisions(Tilemap *tilemap, c2AABB aabb, Vector2 *velocity) {
+    if (!tilemap->collision_bits) return;
+
+    Tile_Range range = get_overlapped_tile_range(tilemap, aabb);
+    if (!tile_range_has_collision(tilemap, range)) return;
+
+    Vector2 origin = tilemap->position();
+    for (int y = range.y0; y <= range.y1; y++) {
+        for (int x = range.x0; x <= range.x1; x++) {
+            if (!is_tile_collidable(tilemap, x, y)) continue;
+
+            c2AABB tile_aabb;
+            tile_aabb.min = { origin.x + x, origin.y + y };
+            tile_aabb.max = { origin.x + x + 1.0f, origin.y + y + 1.0f };
+
+            c2Manifold m;
+            c2AABBtoAABBManifold(aabb, tile_aabb, &m);
+            if (m.count) {
+                if (m.n.x != 0.0f) velocity->x = 0.0f;
+                if (m.n.y != 0.0f) velocity->y = 0.0f;
+            }
+        }
+    }
+}
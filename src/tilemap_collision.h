@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cute_c2.h>
+
+struct Tilemap;
+struct Vector2;
+
+//
+// Collision against the tilemap only looks at the tiles a mover's AABB overlaps, and reads
+// whether they are collidable from a bitset with one bit per tile, so the cost per mover
+// doesn't depend on the size of the map.
+//
+// Tile (x, y) covers tilemap->position + (x, y) to tilemap->position + (x+1, y+1).
+//
+
+struct Tile_Range {
+    int x0, y0;
+    int x1, y1; // Inclusive. The range is empty if x1 < x0 or y1 < y0.
+};
+
+// Builds tilemap->collision_bits from is_collidable, which has one entry per tile.
+void build_tilemap_collision_bits(Tilemap *tilemap, bool *is_collidable);
+
+bool is_tile_collidable(Tilemap *tilemap, int x, int y);
+
+// Tiles that touch aabb, clamped to the map.
+Tile_Range get_overlapped_tile_range(Tilemap *tilemap, c2AABB aabb);
+bool tile_range_has_collision(Tilemap *tilemap, Tile_Range range);
+
+// aabb is the mover at the position it is about to move to. Zeroes the components of velocity
+// along which it would end up inside a collidable tile.
+void resolve_tile_collisions(Tilemap *tilemap, c2AABB aabb, Vector2 *velocity);
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "tilemap_mesh.h"
+#include "entities.h"
+#include "render.h"
+#include "game.h"
+#include "texture_registry.h"
+#include "tilemap_collision.h"
+
+static void allocate_chunks(Tilemap *tilemap) {
+    tilemap->num_chunks_x = (tilemap->width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    tilemap->num_chunks_y = (tilemap->height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    tilemap->chunks = new Tilemap_Chunk[tilemap->num_chunks_x * tilemap->num_chunks_y];
+}
+
+static void release_chunk_meshes(Tilemap_Chunk *chunk) {
+    for (Tilemap_Chunk_Mesh &mesh : chunk->meshes) release_vertex_buffer(mesh.vertex_buffer);
+    chunk->meshes.clear();
+}
+
+static void build_chunk(Tilemap *tilemap, Tilemap_Chunk *chunk, int chunk_x, int chunk_y) {
+    Temporary_Storage_Scope scope; // A whole map can get built in one frame.
+    
+    release_chunk_meshes(chunk);
+
+    chunk->dirty = false;
+    chunk->origin = tilemap->position();
+    chunk->region_generation = globals.texture_registry->region_generation;
+
+    int x0 = chunk_x * TILEMAP_CHUNK_SIZE;
+    int y0 = chunk_y * TILEMAP_CHUNK_SIZE;
+    int x1 = Min(x0 + TILEMAP_CHUNK_SIZE, tilemap->width);
+    int y1 = Min(y0 + TILEMAP_CHUNK_SIZE, tilemap->height);
+
+    Array <Texture *> textures;
+    textures.use_temporary_storage = true;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            Tile *tile = &tilemap->tiles[y * tilemap->width + x];
+            if (!tile->id) continue;
+
+            Texture_Region *region = tilemap->textures[tile->id-1];
+            if (region && textures.find(region->texture) == -1) textures.add(region->texture);
+        }
+    }
+
+    Array <Vertex_Sprite> vertices;
+    vertices.use_temporary_storage = true;
+    vertices.reserve((x1 - x0) * (y1 - y0) * 4);
+
+    u32 white = pack_rgba8(Vector4(1, 1, 1, 1));
+
+    for (Texture *texture : textures) {
+        vertices.clear();
+
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                Tile *tile = &tilemap->tiles[y * tilemap->width + x];
+                if (!tile->id) continue;
+
+                Texture_Region *region = tilemap->textures[tile->id-1];
+                if (!region || region->texture != texture) continue;
+
+                Vector2 p0 = chunk->origin + Vector2((float)x, (float)y);
+
+                vertices.resize(vertices.count + 4);
+                put_sprite_quad(&vertices[vertices.count - 4], p0, p0 + Vector2(1, 1), region->uv0, region->uv1, white);
+            }
+        }
+
+        Tilemap_Chunk_Mesh mesh;
+        mesh.texture = texture;
+        mesh.vertex_buffer = create_vertex_buffer(RENDER_VERTEX_SPRITE, vertices.data, vertices.count);
+        if (mesh.vertex_buffer) chunk->meshes.add(mesh);
+    }
+}
+
+void mark_tile_dirty(Tilemap *tilemap, int x, int y) {
+    if (!tilemap->chunks) return;
+    if (x < 0 || y < 0 || x >= tilemap->width || y >= tilemap->height) return;
+
+    int chunk_x = x / TILEMAP_CHUNK_SIZE;
+    int chunk_y = y / TILEMAP_CHUNK_SIZE;
+    tilemap->chunks[chunk_y * tilemap->num_chunks_x + chunk_x].dirty = true;
+}
+
+void mark_all_tilemap_chunks_dirty(Tilemap *tilemap) {
+    int num_chunks = tilemap->num_chunks_x * tilemap->num_chunks_y;
+    for (int i = 0; i < num_chunks; i++) tilemap->chunks[i].dirty = true;
+}
+
+int draw_tilemap_chunks(Tilemap *tilemap, Shader *shader, Tile_Range visible_tiles) {
+    if (!tilemap->tiles) return 0;
+    if (visible_tiles.x1 < visible_tiles.x0 || visible_tiles.y1 < visible_tiles.y0) return 0;
+    if (!tilemap->chunks) allocate_chunks(tilemap);
+
+    set_shader(shader);
+
+    Vector2 origin = tilemap->position();
+    u32 region_generation = globals.texture_registry->region_generation;
+
+    int chunk_x0 = visible_tiles.x0 / TILEMAP_CHUNK_SIZE;
+    int chunk_y0 = visible_tiles.y0 / TILEMAP_CHUNK_SIZE;
+    int chunk_x1 = visible_tiles.x1 / TILEMAP_CHUNK_SIZE;
+    int chunk_y1 = visible_tiles.y1 / TILEMAP_CHUNK_SIZE;
+
+    int num_chunks_drawn = 0;
+    for (int chunk_y = chunk_y0; chunk_y <= chunk_y1; chunk_y++) {
+        for (int chunk_x = chunk_x0; chunk_x <= chunk_x1; chunk_x++) {
+            Tilemap_Chunk *chunk = &tilemap->chunks[chunk_y * tilemap->num_chunks_x + chunk_x];
+
+            bool out_of_date = chunk->dirty || chunk->region_generation != region_generation;
+            out_of_date = out_of_date || chunk->origin.x != origin.x || chunk->origin.y != origin.y;
+            if (out_of_date) build_chunk(tilemap, chunk, chunk_x, chunk_y);
+
+            for (Tilemap_Chunk_Mesh &mesh : chunk->meshes) {
+                set_texture(0, mesh.texture);
+                draw_vertex_buffer(mesh.vertex_buffer);
+            }
+            num_chunks_drawn += 1;
+        }
+    }
+
+    return num_chunks_drawn;
+}
+
+void release_tilemap_chunks(Tilemap *tilemap) {
+    if (!tilemap->chunks) return;
+
+    int num_chunks = tilemap->num_chunks_x * tilemap->num_chunks_y;
+    for (int i = 0; i < num_chunks; i++) release_chunk_meshes(&tilemap->chunks[i]);
+
+    delete [] tilemap->chunks;
+    tilemap->chunks = NULL;
+    tilemap->num_chunks_x = 0;
+    tilemap->num_chunks_y = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+struct Tilemap;
+struct Texture;
+struct Shader;
+struct Vertex_Buffer;
+struct Tile_Range;
+
+//
+// Tilemaps don't change while the game runs, so instead of building their quads every frame
+// they get split into chunks of TILEMAP_CHUNK_SIZE by TILEMAP_CHUNK_SIZE tiles, and every chunk
+// keeps a vertex buffer per texture it uses (just one, with an atlas). A chunk is only built
+// again when it gets marked dirty, when the tilemap moves, or when the atlas regions change.
+//
+// Whatever changes tilemap->tiles has to call mark_tile_dirty for the tiles it changed.
+//
+
+const int TILEMAP_CHUNK_SIZE = 32;
+
+struct Tilemap_Chunk_Mesh {
+    Texture *texture = NULL;
+    Vertex_Buffer *vertex_buffer = NULL;
+};
+
+struct Tilemap_Chunk {
+    bool dirty = true;
+
+    // What the meshes were built with.
+    Vector2 origin;
+    u32 region_generation = 0;
+
+    Array <Tilemap_Chunk_Mesh> meshes;
+};
+
+void mark_tile_dirty(Tilemap *tilemap, int x, int y);
+void mark_all_tilemap_chunks_dirty(Tilemap *tilemap);
+
+// Builds and draws the chunks that have tiles in visible_tiles. Returns how many it drew.
+int draw_tilemap_chunks(Tilemap *tilemap, Shader *shader, Tile_Range visible_tiles);
+
+void release_tilemap_chunks(Tilemap *tilemap);